@@ -0,0 +1,98 @@
+// Times sorting draw keys laid out like RenderSystem's (pipeline, material, model, depth) with
+// std::sort, the serial radix sort and the parallel radix sort, over a range of draw counts. Build it
+// with src/radix_sort.cpp.
+//
+//   draw_sort_benchmark [runs] [threads]
+
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+
+namespace {
+	// Same field widths as RenderSystem's draw keys; a few pipelines, a scene's worth of materials
+	// and models, and depths spread over a hundred units
+	std::vector<live::SortKey> makeKeys(size_t count, std::mt19937_64& random) {
+		std::uniform_int_distribution<uint64_t> pipeline{ 0, 3 };
+		std::uniform_int_distribution<uint64_t> material{ 0, 255 };
+		std::uniform_int_distribution<uint64_t> model{ 0, 1023 };
+		std::uniform_real_distribution<float>   depth{ 0.1f, 100.0f };
+
+		std::vector<live::SortKey> keys(count);
+		for (size_t i = 0; i < count; i++) {
+			float    viewDepth = depth(random);
+			uint32_t depthBits;
+			std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+
+			keys[i].key = pipeline(random) << 60 | material(random) << 44 | model(random) << 24 | depthBits >> 7;
+			keys[i].index = static_cast<uint32_t>(i);
+		}
+		return keys;
+	}
+
+	// Best of `runs` in microseconds; every run sorts a fresh copy of the same keys
+	double timeSort(int runs, const std::vector<live::SortKey>& input, std::vector<live::SortKey>& output,
+		const std::function<void(std::vector<live::SortKey>&)>& sort) {
+		double best = 1e30;
+		for (int run = 0; run < runs; run++) {
+			output = input;
+			auto start = std::chrono::steady_clock::now();
+			sort(output);
+			best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	bool sameOrder(const std::vector<live::SortKey>& a, const std::vector<live::SortKey>& b) {
+		return std::equal(a.begin(), a.end(), b.begin(), [](const live::SortKey& x, const live::SortKey& y) {
+			return x.key == y.key && x.index == y.index;
+		});
+	}
+}
+
+
+int main(int argc, char** argv) {
+	int runs = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 5;
+	unsigned threadCount = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+
+	std::mt19937_64 random{ 42 };
+	std::vector<live::SortKey> scratch{};
+	std::vector<live::SortKey> reference{};
+	std::vector<live::SortKey> serial{};
+	std::vector<live::SortKey> parallel{};
+
+	std::cout << "draws, std::stable_sort us, radix us, radix x" << threadCount << " us, speedup\n";
+	for (size_t count = 1024; count <= 4 * 1024 * 1024; count *= 4) {
+		std::vector<live::SortKey> keys = makeKeys(count, random);
+
+		// stable_sort is the reference because draws with equal keys must keep submission order
+		double stdTime = timeSort(runs, keys, reference, [](std::vector<live::SortKey>& values) {
+			std::stable_sort(values.begin(), values.end(), [](const live::SortKey& a, const live::SortKey& b) { return a.key < b.key; });
+		});
+		double serialTime = timeSort(runs, keys, serial, [&](std::vector<live::SortKey>& values) {
+			live::radixSort(values, scratch, 1);
+		});
+		double parallelTime = timeSort(runs, keys, parallel, [&](std::vector<live::SortKey>& values) {
+			live::radixSort(values, scratch, threadCount);
+		});
+
+		if (!sameOrder(reference, serial) || !sameOrder(reference, parallel)) {
+			std::cerr << count << " draws: radix sort order differs from std::stable_sort\n";
+			return EXIT_FAILURE;
+		}
+
+		std::cout << count << ", " << stdTime << ", " << serialTime << ", " << parallelTime << ", "
+			<< stdTime / std::min(serialTime, parallelTime) << "x\n";
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+// Times Model::Builder's OBJ loaders on one file: the tinyobjloader reference, the streaming
+// parser and the parallel chunked parser. Build it with the engine sources except main.cpp.
+//
+//   obj_load_benchmark <file.obj> [runs] [threads]
+
+#include "model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+	struct Result {
+		double seconds;
+		size_t vertexCount;
+		size_t indexCount;
+		std::vector<uint32_t> indices;
+		std::vector<std::string> triangleMaterials;  // material name of every triangle, in index order
+	};
+
+	std::vector<std::string> getTriangleMaterials(const live::Model::Builder& builder) {
+		std::vector<std::string> triangleMaterials(builder.indices.size() / 3, builder.materials.empty() ? std::string{} : builder.materials[0].name);
+		for (const auto& submesh : builder.submeshes) {
+			for (uint32_t index = submesh.firstIndex; index < submesh.firstIndex + submesh.indexCount; index += 3) {
+				triangleMaterials[index / 3] = builder.materials[submesh.material].name;
+			}
+		}
+		return triangleMaterials;
+	}
+
+	// Best of `runs`, which filters out page cache warm-up and scheduling noise
+	Result timeLoader(int runs, const std::function<void(live::Model::Builder&)>& load) {
+		Result best{ 1e30, 0, 0, {}, {} };
+		for (int run = 0; run < runs; run++) {
+			live::Model::Builder builder{};
+			auto start = std::chrono::steady_clock::now();
+			load(builder);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			best.seconds = std::min(best.seconds, seconds);
+			best.vertexCount = builder.vertices.size();
+			best.indexCount = builder.indices.size();
+			best.triangleMaterials = getTriangleMaterials(builder);
+			best.indices = std::move(builder.indices);
+		}
+		return best;
+	}
+
+	void report(const std::string& name, const Result& result, const Result& reference, size_t fileSize) {
+		std::cout << name << ": " << result.seconds * 1000.0 << " ms, "
+			<< fileSize / result.seconds / (1024.0 * 1024.0) << " MB/s, "
+			<< result.vertexCount << " vertices, " << result.indexCount / 3 << " triangles, "
+			<< reference.seconds / result.seconds << "x\n";
+	}
+}
+
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " <file.obj> [runs] [threads]\n";
+		return EXIT_FAILURE;
+	}
+
+	std::string filepath = argv[1];
+	int runs = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 3;
+	unsigned threadCount = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+
+	try {
+		size_t fileSize = 0;
+		{
+			std::ifstream file{ filepath, std::ios::binary | std::ios::ate };
+			fileSize = static_cast<size_t>(file.tellg());
+		}
+
+		Result tinyObj = timeLoader(runs, [&](live::Model::Builder& builder) { builder.loadModelsTinyObj(filepath); });
+		Result streaming = timeLoader(runs, [&](live::Model::Builder& builder) { builder.loadModels(filepath, 1); });
+		Result parallel = timeLoader(runs, [&](live::Model::Builder& builder) { builder.loadModels(filepath, threadCount); });
+
+		// The streaming and parallel paths must agree exactly, down to the material of every triangle;
+		// tinyobj deduplicates by vertex value instead of by index triple, so its counts can differ.
+		if (streaming.vertexCount != parallel.vertexCount || streaming.indices != parallel.indices ||
+			streaming.triangleMaterials != parallel.triangleMaterials) {
+			std::cerr << "streaming and parallel results differ\n";
+			return EXIT_FAILURE;
+		}
+
+		std::cout << filepath << ", " << fileSize / (1024.0 * 1024.0) << " MB, best of " << runs << " runs\n";
+		report("tinyobjloader", tinyObj, tinyObj, fileSize);
+		report("streaming", streaming, tinyObj, fileSize);
+		report("parallel x" + std::to_string(threadCount), parallel, tinyObj, fileSize);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+// Compiles a deferred-style sample frame with RenderGraph and checks what it planned: the unused
+// pass is culled, every pass gets the layout transitions it needs, and transient images whose
+// lifetimes don't overlap share memory. Needs a Vulkan device; build it with the engine sources
+// except main.cpp.
+//
+//   render_graph_check
+
+#include "engine_device.h"
+#include "live_window.h"
+#include "render_graph.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+	struct Transition {
+		live::RenderGraph::ResourceId image;
+		VkImageLayout                 oldLayout;
+		VkImageLayout                 newLayout;
+	};
+
+	bool checkBarriers(
+		const std::string& name,
+		const std::vector<live::RenderGraph::ImageBarrier>& barriers,
+		const std::vector<Transition>& expected) {
+		bool matches = barriers.size() == expected.size();
+		for (size_t i = 0; matches && i < barriers.size(); i++) {
+			matches = barriers[i].resource == expected[i].image &&
+				barriers[i].oldLayout == expected[i].oldLayout &&
+				barriers[i].newLayout == expected[i].newLayout;
+		}
+
+		if (!matches) {
+			std::cerr << name << ": planned barriers differ from the expected transitions\n";
+			for (const auto& barrier : barriers) {
+				std::cerr << "  image " << barrier.resource << ": " << barrier.oldLayout << " -> " << barrier.newLayout << '\n';
+			}
+		}
+		return matches;
+	}
+
+	bool check(const std::string& what, bool passed) {
+		if (!passed) {
+			std::cerr << what << '\n';
+		}
+		return passed;
+	}
+}
+
+
+int main() {
+	try {
+		live::LiveWindow window{ 64, 64, "render_graph_check" };
+		live::LiveDevice device{ window };
+
+		const VkExtent2D extent{ 1280, 720 };
+		VkFormat depthFormat = device.findSupportedFormat(
+			{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+		using ResourceId = live::RenderGraph::ResourceId;
+		ResourceId albedo, depth, lit, bloom;
+
+		live::RenderGraph graph{ device };
+		ResourceId backbuffer = graph.importImage("backbuffer", { VK_FORMAT_B8G8R8A8_UNORM, extent }, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		auto gbufferPass = graph.addPass(
+			"gbuffer",
+			[&](live::RenderGraph::PassBuilder& builder) {
+				albedo = builder.createImage("albedo", { VK_FORMAT_R8G8B8A8_UNORM, extent });
+				depth = builder.createImage("depth", { depthFormat, extent });
+				builder.writeColor(albedo);
+				builder.writeDepth(depth);
+			},
+			[](live::RenderGraph::PassContext&) {});
+		auto lightingPass = graph.addPass(
+			"lighting",
+			[&](live::RenderGraph::PassBuilder& builder) {
+				lit = builder.createImage("lit", { VK_FORMAT_R16G16B16A16_SFLOAT, extent });
+				builder.readSampled(albedo);
+				builder.readDepth(depth);
+				builder.writeColor(lit);
+			},
+			[](live::RenderGraph::PassContext&) {});
+		auto bloomPass = graph.addPass(
+			"bloom",
+			[&](live::RenderGraph::PassBuilder& builder) {
+				bloom = builder.createImage("bloom", { VK_FORMAT_R8G8B8A8_UNORM, extent });
+				builder.readSampled(lit);
+				builder.writeColor(bloom);
+			},
+			[](live::RenderGraph::PassContext&) {});
+		auto compositePass = graph.addPass(
+			"composite",
+			[&](live::RenderGraph::PassBuilder& builder) {
+				builder.readSampled(lit);
+				builder.readSampled(bloom);
+				builder.writeColor(backbuffer);
+			},
+			[](live::RenderGraph::PassContext&) {});
+		// Nothing reads its output, so it must be culled
+		auto debugPass = graph.addPass(
+			"debug_view",
+			[&](live::RenderGraph::PassBuilder& builder) {
+				ResourceId view = builder.createImage("debug_view", { VK_FORMAT_R8G8B8A8_UNORM, extent });
+				builder.readSampled(albedo);
+				builder.writeColor(view);
+			},
+			[](live::RenderGraph::PassContext&) {});
+
+		graph.compile();
+
+		const VkImageLayout undefined = VK_IMAGE_LAYOUT_UNDEFINED;
+		const VkImageLayout color = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		const VkImageLayout sampled = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		const VkImageLayout present = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		bool passed = true;
+		passed &= check("debug_view was not culled", graph.isPassCulled(debugPass));
+		passed &= check("a pass feeding the backbuffer was culled",
+			!graph.isPassCulled(gbufferPass) && !graph.isPassCulled(lightingPass) &&
+			!graph.isPassCulled(bloomPass) && !graph.isPassCulled(compositePass));
+
+		passed &= checkBarriers("gbuffer", graph.getBarriers(gbufferPass), {
+			{ albedo, undefined, color },
+			{ depth, undefined, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL } });
+		passed &= checkBarriers("lighting", graph.getBarriers(lightingPass), {
+			{ albedo, color, sampled },
+			{ depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL },
+			{ lit, undefined, color } });
+		passed &= checkBarriers("bloom", graph.getBarriers(bloomPass), {
+			{ lit, color, sampled },
+			{ bloom, undefined, color } });
+		// lit is still in the layout bloom sampled it in, so only bloom and the backbuffer transition
+		passed &= checkBarriers("composite", graph.getBarriers(compositePass), {
+			{ bloom, color, sampled },
+			{ backbuffer, present, color } });
+		passed &= checkBarriers("final", graph.getFinalBarriers(), {
+			{ backbuffer, color, present } });
+
+		// albedo and depth die after lighting, before bloom is first written; lit outlives them all
+		passed &= check("bloom was not placed in memory freed by the G-buffer",
+			graph.sharesMemory(bloom, albedo) || graph.sharesMemory(bloom, depth));
+		passed &= check("images with overlapping lifetimes share memory",
+			!graph.sharesMemory(albedo, depth) && !graph.sharesMemory(lit, albedo) &&
+			!graph.sharesMemory(lit, depth) && !graph.sharesMemory(lit, bloom));
+		passed &= check("aliasing saved no memory", graph.getTransientMemory() < graph.getUnaliasedMemory());
+
+		std::cout << "transient memory: " << graph.getTransientMemory() / 1024 << " KiB aliased, "
+			<< graph.getUnaliasedMemory() / 1024 << " KiB unaliased\n";
+		std::cout << (passed ? "render graph plan matches\n" : "render graph plan differs\n");
+
+		if (!passed) {
+			return EXIT_FAILURE;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,3 +1,17 @@
-D:\VulkanSDK\1.3.236.0\Bin\glslc.exe shaders\simple_shader.vert -o shaders\simple_shader.vert.spv
-D:\VulkanSDK\1.3.236.0\Bin\glslc.exe shaders\simple_shader.frag -o shaders\simple_shader.frag.spv
-pause
\ No newline at end of file
+@echo off
+set GLSLC="%VULKAN_SDK%\Bin\glslc.exe"
+%GLSLC% shaders\simple_shader.vert -o shaders\simple_shader.vert.spv || goto :error
+%GLSLC% shaders\simple_shader.frag -o shaders\simple_shader.frag.spv || goto :error
+%GLSLC% shaders\bindless_shader.vert -o shaders\bindless_shader.vert.spv || goto :error
+%GLSLC% shaders\bindless_shader.frag -o shaders\bindless_shader.frag.spv || goto :error
+%GLSLC% shaders\simple_shader_packed.vert -o shaders\simple_shader_packed.vert.spv || goto :error
+%GLSLC% shaders\bindless_shader_packed.vert -o shaders\bindless_shader_packed.vert.spv || goto :error
+%GLSLC% shaders\simple_shader_depth.vert -o shaders\simple_shader_depth.vert.spv || goto :error
+%GLSLC% shaders\bindless_shader_depth.vert -o shaders\bindless_shader_depth.vert.spv || goto :error
+pause
+exit /b 0
+
+:error
+echo Shader compilation failed
+pause
+exit /b 1
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec2 fragUv;
+layout (location = 2) flat in uint fragTextureIndex;
+
+layout (location = 0) out vec4 outColor;
+
+layout(set = 2, binding = 0) uniform sampler2D textures[];
+
+const uint INVALID_INDEX = 0xFFFFFFFF;
+
+
+void main() {
+	vec3 color = fragColor;
+
+	if (fragTextureIndex != INVALID_INDEX) {
+		color *= texture(textures[nonuniformEXT(fragTextureIndex)], fragUv).rgb;
+	}
+
+	outColor = vec4(color, 1.0);
+}
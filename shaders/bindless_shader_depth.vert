@@ -0,0 +1,24 @@
+#version 450
+
+// Bindless variant of simple_shader_depth.vert, see there
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+struct ObjectData {
+	mat4 modelMatrix;
+	uint textureIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+} objectBuffer;
+
+void main() {
+	gl_Position = ubo.projectionViewMatrix * objectBuffer.objects[gl_InstanceIndex].modelMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,62 @@
+#version 450
+
+// Model::PackedVertex: position is unorm16 within the model bounds (the model matrix includes the
+// dequantization), normal is octahedral in the same quantized space.
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 encodedNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUv;
+layout(location = 2) flat out uint fragTextureIndex;
+
+// Must match the depth pre-pass bit for bit, see simple_shader_depth.vert
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+struct ObjectData {
+	mat4 modelMatrix;
+	uint textureIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+} objectBuffer;
+
+const float AMBIENT = 0.02;
+
+// Inverse of octahedralEncode in model.cpp
+vec3 octahedralDecode(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return n;
+}
+
+void main() {
+	vec3 normal = octahedralDecode(encodedNormal);
+
+	ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+
+	gl_Position = ubo.projectionViewMatrix * object.modelMatrix * vec4(position.xyz, 1.0);
+
+	// See simple_shader.vert for the normal matrix derivation
+	mat3 modelMatrix = mat3(object.modelMatrix);
+	vec3 inverseScaleSquared = 1.0 / vec3(
+		dot(modelMatrix[0], modelMatrix[0]),
+		dot(modelMatrix[1], modelMatrix[1]),
+		dot(modelMatrix[2], modelMatrix[2]));
+	vec3 normalWorldSpace = normalize(modelMatrix * (inverseScaleSquared * normal));
+
+	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
+
+	fragColor = lightIntensity * color.rgb;
+	fragUv = uv;
+	fragTextureIndex = object.textureIndex;
+}
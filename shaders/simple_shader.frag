@@ -3,12 +3,7 @@
 layout (location = 0) in vec3 fragColor;
 layout (location = 0) out vec4 outColor;
 
-layout(push_constant) uniform Push {
-	mat4 transform;
-	mat4 normalMatrix;
-} push;
-
 
 void main() {
 	outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+}
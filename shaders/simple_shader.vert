@@ -7,20 +7,33 @@ layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 
+// Must match the depth pre-pass bit for bit, see simple_shader_depth.vert
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
 layout(push_constant) uniform Push {
-	mat4 transform;
-	mat4 normalMatrix;
+	mat4 modelMatrix;
 } push;
 
-const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, -3.0, -1.0));
 const float AMBIENT = 0.02;
 
 void main() {
-	gl_Position = push.transform * vec4(position, 1.0);
+	gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
 
-	vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+	// The model matrix is rotation * scale, so its inverse transpose is the same matrix with each
+	// column divided by its squared length.
+	mat3 modelMatrix = mat3(push.modelMatrix);
+	vec3 inverseScaleSquared = 1.0 / vec3(
+		dot(modelMatrix[0], modelMatrix[0]),
+		dot(modelMatrix[1], modelMatrix[1]),
+		dot(modelMatrix[2], modelMatrix[2]));
+	vec3 normalWorldSpace = normalize(modelMatrix * (inverseScaleSquared * normal));
 
-	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
+	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
 
 	fragColor = lightIntensity * color;
-}
\ No newline at end of file
+}
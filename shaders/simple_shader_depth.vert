@@ -0,0 +1,22 @@
+#version 450
+
+// Depth pre-pass over Model's position-only stream. The color pass then tests with EQUAL, so
+// gl_Position has to come out bit-identical to the color vertex shaders: same inputs, same
+// expression, and invariant everywhere. Packed positions arrive as unorm16, already in the model's
+// quantized space like in simple_shader_packed.vert.
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+} push;
+
+void main() {
+	gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
+}
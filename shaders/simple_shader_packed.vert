@@ -0,0 +1,52 @@
+#version 450
+
+// Model::PackedVertex: position is unorm16 within the model bounds (the model matrix includes the
+// dequantization), normal is octahedral in the same quantized space.
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 encodedNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+
+// Must match the depth pre-pass bit for bit, see simple_shader_depth.vert
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+} push;
+
+const float AMBIENT = 0.02;
+
+// Inverse of octahedralEncode in model.cpp
+vec3 octahedralDecode(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return n;
+}
+
+void main() {
+	vec3 normal = octahedralDecode(encodedNormal);
+
+	gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position.xyz, 1.0);
+
+	// The model matrix is rotation * scale, so its inverse transpose is the same matrix with each
+	// column divided by its squared length.
+	mat3 modelMatrix = mat3(push.modelMatrix);
+	vec3 inverseScaleSquared = 1.0 / vec3(
+		dot(modelMatrix[0], modelMatrix[0]),
+		dot(modelMatrix[1], modelMatrix[1]),
+		dot(modelMatrix[2], modelMatrix[2]));
+	vec3 normalWorldSpace = normalize(modelMatrix * (inverseScaleSquared * normal));
+
+	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
+
+	fragColor = lightIntensity * color.rgb;
+}
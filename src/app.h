@@ -1,10 +1,17 @@
 #pragma once
 
+#include "bindless_descriptors.h"
 #include "engine_device.h"
+#include "frame_allocator.h"
+#include "live_descriptors.h"
 #include "live_window.h"
+#include "material_library.h"
 #include "model.h"
 #include "object.h"
+#include "pipeline_cache.h"
 #include "renderer.h"
+#include "sampler_cache.h"
+#include "texture_streamer.h"
 
 #include <memory>
 #include <vector>
@@ -16,6 +23,8 @@ namespace live {
 		static constexpr int WIDTH  = 800;
 		static constexpr int HEIGHT = 600;
 
+		static constexpr VkDeviceSize FRAME_ALLOCATOR_CAPACITY = 4 * 1024 * 1024;
+
 		Application();
 		~Application();
 
@@ -26,10 +35,20 @@ namespace live {
 
 	private:
 		void loadObjects();
+		void loadTextures();
+		void printMemoryUsage();
 
 		LiveWindow                     liveWindow{WIDTH, HEIGHT, "Hello Vulkan"};
 		LiveDevice                     liveDevice{ liveWindow };
 		Renderer                       renderer{ liveWindow, liveDevice };
+
+		std::unique_ptr<FrameAllocator>      frameAllocator{};
+		std::unique_ptr<LiveDescriptorPool>  globalPool{};
+		std::unique_ptr<BindlessDescriptors> bindlessDescriptors{};
+		MaterialLibrary                materialLibrary{};
+		SamplerCache                   samplerCache{ liveDevice };
+		PipelineCache                  pipelineCache{ liveDevice };
+		std::unique_ptr<TextureStreamer> textureStreamer{};
 		std::vector<Object>            objects;
 	};
 }
\ No newline at end of file
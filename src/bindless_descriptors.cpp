@@ -0,0 +1,80 @@
+#include "bindless_descriptors.h"
+
+#include <cassert>
+#include <stdexcept>
+
+
+namespace live {
+	BindlessDescriptors::BindlessDescriptors(LiveDevice& device, FrameAllocator& frameAllocator) : liveDevice{ device } {
+		assert(device.enabledFeatures.descriptorIndexing && "Bindless descriptors require descriptor indexing");
+
+		// Dynamic descriptors cannot live in update-after-bind layouts, hence the two sets
+		objectSetLayout = LiveDescriptorSetLayout::Builder(liveDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+			.build();
+
+		objectPool = LiveDescriptorPool::Builder(liveDevice)
+			.setMaxSets(1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1)
+			.build();
+
+		// The range is resolved at bind time to the end of the buffer from the dynamic offset
+		VkDescriptorBufferInfo objectBufferInfo{ frameAllocator.getBuffer(), 0, VK_WHOLE_SIZE };
+		if (!LiveDescriptorWriter(*objectSetLayout, *objectPool).writeBuffer(0, &objectBufferInfo).build(objectSet)) {
+			throw std::runtime_error("Failed to allocate bindless object descriptor set.");
+		}
+
+		textureSetLayout = LiveDescriptorSetLayout::Builder(liveDevice)
+			.addBinding(
+				0,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				MAX_TEXTURES,
+				VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+				VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT |
+				VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+			.setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+			.build();
+
+		texturePool = LiveDescriptorPool::Builder(liveDevice)
+			.setMaxSets(1)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES)
+			.build();
+
+		if (!texturePool->allocateDescriptorSet(textureSetLayout->getDescriptorSetLayout(), textureSet, MAX_TEXTURES)) {
+			throw std::runtime_error("Failed to allocate bindless texture descriptor set.");
+		}
+	}
+
+	BindlessDescriptors::~BindlessDescriptors() {}
+
+	uint32_t BindlessDescriptors::registerTexture(const VkDescriptorImageInfo& imageInfo) {
+		uint32_t index;
+		if (!freeTextureSlots.empty()) {
+			index = freeTextureSlots.back();
+			freeTextureSlots.pop_back();
+		} else {
+			if (nextTextureSlot >= MAX_TEXTURES) {
+				throw std::runtime_error("Bindless texture table is full.");
+			}
+			index = nextTextureSlot++;
+		}
+
+		updateTexture(index, imageInfo);
+		return index;
+	}
+
+	// Slots are update-after-bind, so this is safe while frames that don't sample the slot are in flight
+	void BindlessDescriptors::updateTexture(uint32_t index, const VkDescriptorImageInfo& imageInfo) {
+		auto info = imageInfo;
+		LiveDescriptorWriter(*textureSetLayout, *texturePool).writeImageArrayElement(0, index, &info).overwrite(textureSet);
+	}
+
+	// The caller must make sure no frame in flight still samples the slot, e.g. by releasing it from
+	// LiveDevice::deferDestruction.
+	void BindlessDescriptors::releaseTexture(uint32_t index) {
+		assert(index < nextTextureSlot && "Releasing a texture slot that was never registered");
+		freeTextureSlots.push_back(index);
+	}
+}
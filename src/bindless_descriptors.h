@@ -0,0 +1,60 @@
+#pragma once
+
+#include "engine_device.h"
+#include "frame_allocator.h"
+#include "live_descriptors.h"
+
+#define GLM_DEFINE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+
+namespace live {
+	// Per-draw data read by the bindless shaders, indexed by gl_InstanceIndex (firstInstance)
+	struct ObjectData {
+		glm::mat4 modelMatrix{ 1.0f };
+		uint32_t  textureIndex = ~0u;
+		uint32_t  padding[3]{};
+	};
+
+	// Descriptor sets 1 and 2 of the bindless pipelines. Set 1 is a dynamic storage buffer over the
+	// frame allocator holding every draw's ObjectData; set 2 is one large, partially bound sampled
+	// image array that textures register into once. Requires DeviceFeatureSupport::descriptorIndexing.
+	class BindlessDescriptors {
+	public:
+		static constexpr uint32_t MAX_TEXTURES  = 4096;
+		static constexpr uint32_t INVALID_INDEX = ~0u;
+
+		BindlessDescriptors(LiveDevice& device, FrameAllocator& frameAllocator);
+		~BindlessDescriptors();
+
+		BindlessDescriptors(const BindlessDescriptors&) = delete;
+		BindlessDescriptors& operator=(const BindlessDescriptors&) = delete;
+
+		VkDescriptorSetLayout getObjectSetLayout() const { return objectSetLayout->getDescriptorSetLayout(); }
+		VkDescriptorSetLayout getTextureSetLayout() const { return textureSetLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getObjectSet() const { return objectSet; }
+		VkDescriptorSet getTextureSet() const { return textureSet; }
+
+		uint32_t registerTexture(const VkDescriptorImageInfo& imageInfo);
+		void updateTexture(uint32_t index, const VkDescriptorImageInfo& imageInfo);
+		void releaseTexture(uint32_t index);
+
+	private:
+		LiveDevice&                              liveDevice;
+
+		std::unique_ptr<LiveDescriptorSetLayout> objectSetLayout;
+		std::unique_ptr<LiveDescriptorPool>      objectPool;
+		VkDescriptorSet                          objectSet;
+
+		std::unique_ptr<LiveDescriptorSetLayout> textureSetLayout;
+		std::unique_ptr<LiveDescriptorPool>      texturePool;
+		VkDescriptorSet                          textureSet;
+
+		std::vector<uint32_t>                    freeTextureSlots;
+		uint32_t                                 nextTextureSlot = 0;
+	};
+}
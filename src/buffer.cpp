@@ -47,10 +47,21 @@ namespace live {
         device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
     }
 
+    /**
+     * Unmaps the buffer and hands the handles to the device's deletion queue, so a buffer released
+     * while a frame that reads it is still in flight stays alive until that frame completes
+     */
     Buffer::~Buffer() {
         unmap();
-        vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-        vkFreeMemory(lveDevice.device(), memory, nullptr);
+
+        VkDevice device = lveDevice.device();
+        VkBuffer retiredBuffer = buffer;
+        VkDeviceMemory retiredMemory = memory;
+        lveDevice.retireMemory(retiredMemory);
+        lveDevice.deferDestruction([&owner = lveDevice, device, retiredBuffer, retiredMemory]() {
+            vkDestroyBuffer(device, retiredBuffer, nullptr);
+            owner.freeMemory(retiredMemory);
+        });
     }
 
     /**
@@ -26,6 +26,18 @@ void live::Camera::setPerspectiveProjection(float vFOV, float aspectRatio, float
 
 }
 
+float live::Camera::getProjectedHeight(float worldLength, float viewDepth) const {
+	// Orthographic projections have no perspective divide, see setOrthographicProjection
+	if (projectionMatrix[2][3] == 0.0f) {
+		return worldLength * glm::abs(projectionMatrix[1][1]) * 0.5f;
+	}
+
+	if (viewDepth <= std::numeric_limits<float>::epsilon()) {
+		return std::numeric_limits<float>::infinity();
+	}
+	return worldLength * glm::abs(projectionMatrix[1][1]) * 0.5f / viewDepth;
+}
+
 void live::Camera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up) {
 	const glm::vec3 w{ glm::normalize(direction) };
 	const glm::vec3 u{ glm::normalize(glm::cross(w, up)) };
@@ -44,6 +56,7 @@ void live::Camera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm
 	viewMatrix[3][0] = -glm::dot(u, position);
 	viewMatrix[3][1] = -glm::dot(v, position);
 	viewMatrix[3][2] = -glm::dot(w, position);
+	cameraPosition = position;
 }
 
 void live::Camera::setViewTarget(glm::vec3 position, glm::vec3 target, glm::vec3 up) {
@@ -75,4 +88,5 @@ void live::Camera::setViewYXZ(glm::vec3 position, glm::vec3 rotation) {
 	viewMatrix[3][0] = -glm::dot(u, position);
 	viewMatrix[3][1] = -glm::dot(v, position);
 	viewMatrix[3][2] = -glm::dot(w, position);
+	cameraPosition = position;
 }
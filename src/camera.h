@@ -17,9 +17,16 @@ namespace live {
 
 		const glm::mat4& getProjectionMatrix() const { return projectionMatrix; }
 		const glm::mat4& getViewMatrix() const { return viewMatrix; }
+		const glm::vec3& getPosition() const { return cameraPosition; }
+
+		// Distance in front of the camera along the view direction
+		float getViewDepth(glm::vec3 worldPosition) const { return (viewMatrix * glm::vec4{ worldPosition, 1.0f }).z; }
+		// Fraction of the viewport height covered by a world-space length at the given view depth
+		float getProjectedHeight(float worldLength, float viewDepth) const;
 
 	private:
 		glm::mat4 projectionMatrix{ 1.0f };
 		glm::mat4 viewMatrix{ 1.0f };
+		glm::vec3 cameraPosition{ 0.0f };
 	};
 }
\ No newline at end of file
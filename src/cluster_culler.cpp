@@ -0,0 +1,76 @@
+#include "cluster_culler.h"
+
+
+namespace live {
+	// Gribb & Hartmann plane extraction for a [0, 1] depth range
+	Frustum Frustum::fromMatrix(const glm::mat4& matrix) {
+		glm::vec4 row0{ matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0] };
+		glm::vec4 row1{ matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1] };
+		glm::vec4 row2{ matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2] };
+		glm::vec4 row3{ matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3] };
+
+		Frustum frustum{};
+		frustum.planes[0] = row3 + row0;  // left
+		frustum.planes[1] = row3 - row0;  // right
+		frustum.planes[2] = row3 + row1;  // top or bottom, depending on the projection's y axis
+		frustum.planes[3] = row3 - row1;
+		frustum.planes[4] = row2;         // near
+		frustum.planes[5] = row3 - row2;  // far
+
+		for (auto& plane : frustum.planes) {
+			float length = glm::length(glm::vec3{ plane });
+			if (length > 0.0f) {
+				plane /= length;
+			}
+		}
+		return frustum;
+	}
+
+	bool Frustum::intersectsSphere(glm::vec3 center, float radius) const {
+		for (const auto& plane : planes) {
+			if (glm::dot(glm::vec3{ plane }, center) + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t ClusterCuller::cull(
+		const Model& model,
+		uint32_t submesh,
+		const glm::mat4& modelMatrix,
+		const Camera& camera,
+		uint32_t firstInstance,
+		VkDrawIndexedIndirectCommand* commands) {
+		const auto& meshlets = model.getMeshlets();
+		const auto& range = model.getSubmesh(submesh);
+
+		Frustum   frustum = Frustum::fromMatrix(camera.getProjectionMatrix() * camera.getViewMatrix() * modelMatrix);
+		glm::vec3 cameraPosition = glm::vec3{ glm::inverse(modelMatrix) * glm::vec4{ camera.getPosition(), 1.0f } };
+
+		uint32_t drawCount = 0;
+		for (uint32_t i = range.firstMeshlet; i < range.firstMeshlet + range.meshletCount; i++) {
+			const auto& meshlet = meshlets[i];
+			glm::vec3 center{ meshlet.center[0], meshlet.center[1], meshlet.center[2] };
+
+			if (!frustum.intersectsSphere(center, meshlet.radius)) {
+				stats.frustumCulled += 1;
+				continue;
+			}
+
+			if (backfaceCulling) {
+				glm::vec3 axis{ meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2] };
+				glm::vec3 view = center - cameraPosition;
+				if (glm::dot(view, axis) >= meshlet.coneCutoff * glm::length(view) + meshlet.radius) {
+					stats.backfaceCulled += 1;
+					continue;
+				}
+			}
+
+			commands[drawCount++] = model.getMeshletDrawCommand(i, firstInstance);
+		}
+
+		stats.meshlets += range.meshletCount;
+		return drawCount;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "camera.h"
+#include "model.h"
+
+#define GLM_DEFINE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <vulkan/vulkan.h>
+
+
+namespace live {
+	// Clip-space planes of a matrix, normalized so plane distances are in the matrix's input space.
+	// Built from projection * view * model the planes are in model space.
+	struct Frustum {
+		glm::vec4 planes[6];
+
+		static Frustum fromMatrix(const glm::mat4& matrix);
+		bool intersectsSphere(glm::vec3 center, float radius) const;
+	};
+
+	// CPU cluster culling: tests every meshlet of a model against the view frustum and, optionally,
+	// its normal cone, and writes an indexed indirect command for each one that survives. Tests run
+	// in model space, which keeps them exact under non-uniform scale.
+	class ClusterCuller {
+	public:
+		struct Stats {
+			uint32_t meshlets = 0;
+			uint32_t frustumCulled = 0;
+			uint32_t backfaceCulled = 0;
+		};
+
+		// Cone culling is only valid when the pipeline discards back faces. It assumes counter-clockwise
+		// front faces in model space, as OBJ files are authored.
+		void setBackfaceCulling(bool enabled) { backfaceCulling = enabled; }
+
+		// Culls the meshlets of one LOD 0 submesh. commands must have room for the submesh's
+		// meshletCount entries; returns how many were written.
+		uint32_t cull(
+			const Model& model,
+			uint32_t submesh,
+			const glm::mat4& modelMatrix,
+			const Camera& camera,
+			uint32_t firstInstance,
+			VkDrawIndexedIndirectCommand* commands);
+
+		void resetStats() { stats = {}; }
+		const Stats& getStats() const { return stats; }
+
+	private:
+		bool  backfaceCulling = false;
+		Stats stats{};
+	};
+}
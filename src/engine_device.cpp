@@ -1,6 +1,8 @@
 #include "engine_device.h"
+#include "queue_timeline.h"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -52,11 +54,27 @@ LiveDevice::LiveDevice(LiveWindow &window) : window{window} {
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
+  queryDeviceFeatures();
   createLogicalDevice();
+  loadDeviceFunctions();
   createCommandPool();
+
+  std::lock_guard<std::mutex> lock{memoryMutex};
+  queryMemoryBudget();
 }
 
 LiveDevice::~LiveDevice() {
+  vkDeviceWaitIdle(device_);
+  for (auto &pending : deletionQueue) {
+    pending.second();
+  }
+  deletionQueue.clear();
+  for (auto &deleter : frameDeletions) {
+    deleter();
+  }
+  frameDeletions.clear();
+
+  graphicsTimeline_.reset();
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -79,7 +97,21 @@ void LiveDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+
+  // vkEnumerateInstanceVersion does not exist on 1.0 loaders
+  auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+      nullptr,
+      "vkEnumerateInstanceVersion");
+  if (enumerateInstanceVersion != nullptr) {
+    enumerateInstanceVersion(&instanceApiVersion);
+  }
+  if (instanceApiVersion >= VK_API_VERSION_1_3) {
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+  } else if (instanceApiVersion >= VK_API_VERSION_1_2) {
+    appInfo.apiVersion = VK_API_VERSION_1_2;
+  } else {
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+  }
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -129,6 +161,57 @@ void LiveDevice::pickPhysicalDevice() {
   }
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  heaps.resize(memoryProperties.memoryHeapCount);
+}
+
+void LiveDevice::queryDeviceFeatures() {
+  VkPhysicalDeviceFeatures features{};
+  vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+  enabledFeatures.multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+  enabledFeatures.drawIndirectFirstInstance = features.drawIndirectFirstInstance == VK_TRUE;
+  enabledFeatures.textureCompressionBC = features.textureCompressionBC == VK_TRUE;
+  enabledFeatures.textureCompressionETC2 = features.textureCompressionETC2 == VK_TRUE;
+
+  if (!supportsApiVersion(VK_API_VERSION_1_2)) {
+    return;
+  }
+
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+  // Dynamic rendering is core from 1.3; 1.2 devices may offer the extension, whose dependencies
+  // are core in 1.2
+  VkPhysicalDeviceVulkan13Features features13{};
+  features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+  dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  if (supportsApiVersion(VK_API_VERSION_1_3)) {
+    features12.pNext = &features13;
+  } else if (supportsDeviceExtension(physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+    features12.pNext = &dynamicRenderingFeatures;
+    dynamicRenderingExtension = true;
+  }
+
+  // Read through vkGetPhysicalDeviceMemoryProperties2, core since 1.1
+  enabledFeatures.memoryBudget =
+      supportsDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &features12;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+  enabledFeatures.timelineSemaphore = features12.timelineSemaphore == VK_TRUE;
+  enabledFeatures.descriptorIndexing =
+      features12.descriptorIndexing && features12.runtimeDescriptorArray &&
+      features12.descriptorBindingPartiallyBound &&
+      features12.descriptorBindingVariableDescriptorCount &&
+      features12.descriptorBindingSampledImageUpdateAfterBind &&
+      features12.shaderSampledImageArrayNonUniformIndexing;
+  enabledFeatures.dynamicRendering =
+      features13.dynamicRendering == VK_TRUE || dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+  dynamicRenderingExtension = dynamicRenderingExtension && enabledFeatures.dynamicRendering;
 }
 
 void LiveDevice::createLogicalDevice() {
@@ -149,6 +232,10 @@ void LiveDevice::createLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.multiDrawIndirect = enabledFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance = enabledFeatures.drawIndirectFirstInstance;
+  deviceFeatures.textureCompressionBC = enabledFeatures.textureCompressionBC;
+  deviceFeatures.textureCompressionETC2 = enabledFeatures.textureCompressionETC2;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -157,8 +244,40 @@ void LiveDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  features12.timelineSemaphore = enabledFeatures.timelineSemaphore;
+  if (enabledFeatures.descriptorIndexing) {
+    features12.descriptorIndexing = VK_TRUE;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  }
+  if (supportsApiVersion(VK_API_VERSION_1_2)) {
+    createInfo.pNext = &features12;
+  }
+
+  std::vector<const char *> extensions = deviceExtensions;
+  VkPhysicalDeviceVulkan13Features features13{};
+  features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+  dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  if (enabledFeatures.dynamicRendering && dynamicRenderingExtension) {
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    features12.pNext = &dynamicRenderingFeatures;
+    extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+  } else if (enabledFeatures.dynamicRendering) {
+    features13.dynamicRendering = VK_TRUE;
+    features12.pNext = &features13;
+  }
+  if (enabledFeatures.memoryBudget) {
+    extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -175,6 +294,26 @@ void LiveDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+  graphicsTimeline_ =
+      std::make_unique<QueueTimeline>(*this, graphicsQueue_, enabledFeatures.timelineSemaphore);
+}
+
+// Extension commands aren't exported by the loader, so both variants go through vkGetDeviceProcAddr
+void LiveDevice::loadDeviceFunctions() {
+  if (!enabledFeatures.dynamicRendering) {
+    return;
+  }
+
+  cmdBeginRendering_ = reinterpret_cast<PFN_vkCmdBeginRendering>(vkGetDeviceProcAddr(
+      device_,
+      dynamicRenderingExtension ? "vkCmdBeginRenderingKHR" : "vkCmdBeginRendering"));
+  cmdEndRendering_ = reinterpret_cast<PFN_vkCmdEndRendering>(vkGetDeviceProcAddr(
+      device_,
+      dynamicRenderingExtension ? "vkCmdEndRenderingKHR" : "vkCmdEndRendering"));
+  if (cmdBeginRendering_ == nullptr || cmdEndRendering_ == nullptr) {
+    throw std::runtime_error("failed to load dynamic rendering commands!");
+  }
 }
 
 void LiveDevice::createCommandPool() {
@@ -291,6 +430,25 @@ void LiveDevice::hasGflwRequiredInstanceExtensions() {
   }
 }
 
+bool LiveDevice::supportsDeviceExtension(VkPhysicalDevice device, const char *extensionName) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      device,
+      nullptr,
+      &extensionCount,
+      availableExtensions.data());
+
+  for (const auto &extension : availableExtensions) {
+    if (std::strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool LiveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   uint32_t extensionCount;
   vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -384,6 +542,12 @@ VkFormat LiveDevice::findSupportedFormat(
   throw std::runtime_error("failed to find supported format!");
 }
 
+VkFormatProperties LiveDevice::getFormatProperties(VkFormat format) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+  return props;
+}
+
 uint32_t LiveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -397,6 +561,169 @@ uint32_t LiveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags p
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+bool LiveDevice::supportsMemoryProperties(VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    if ((memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void LiveDevice::allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory &memory) {
+  uint32_t heap = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+  VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+
+  std::lock_guard<std::mutex> lock{memoryMutex};
+  if (result != VK_SUCCESS) {
+    MemoryHeapUsage usage = heapUsage(heap);
+    throw std::runtime_error(
+        "failed to allocate " + std::to_string(allocInfo.allocationSize) + " bytes from memory heap " +
+        std::to_string(heap) + " (" + std::to_string(usage.usage) + " of " +
+        std::to_string(usage.budget) + " bytes budget in use)!");
+  }
+
+  allocations.emplace(memory, Allocation{heap, allocInfo.allocationSize, false});
+  heaps[heap].allocated += allocInfo.allocationSize;
+  heaps[heap].allocationCount++;
+}
+
+void LiveDevice::freeMemory(VkDeviceMemory memory) {
+  if (memory == VK_NULL_HANDLE) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{memoryMutex};
+    auto found = allocations.find(memory);
+    if (found != allocations.end()) {
+      HeapTally &tally = heaps[found->second.heap];
+      tally.allocated -= found->second.size;
+      if (found->second.retiring) {
+        tally.retiring -= found->second.size;
+      }
+      tally.allocationCount--;
+      allocations.erase(found);
+    }
+  }
+
+  vkFreeMemory(device_, memory, nullptr);
+}
+
+void LiveDevice::retireMemory(VkDeviceMemory memory) {
+  std::lock_guard<std::mutex> lock{memoryMutex};
+  auto found = allocations.find(memory);
+  if (found != allocations.end() && !found->second.retiring) {
+    found->second.retiring = true;
+    heaps[found->second.heap].retiring += found->second.size;
+  }
+}
+
+// Expects memoryMutex to be held
+void LiveDevice::queryMemoryBudget() {
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+  budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  if (enabledFeatures.memoryBudget) {
+    VkPhysicalDeviceMemoryProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties2.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+  }
+
+  for (uint32_t i = 0; i < heaps.size(); i++) {
+    HeapTally &tally = heaps[i];
+    if (enabledFeatures.memoryBudget) {
+      tally.budget = budgetProperties.heapBudget[i];
+      tally.driverUsage = budgetProperties.heapUsage[i];
+    } else {
+      tally.budget =
+          static_cast<VkDeviceSize>(memoryProperties.memoryHeaps[i].size * DEFAULT_HEAP_BUDGET);
+      tally.driverUsage = tally.allocated;
+    }
+    tally.allocatedAtQuery = tally.allocated;
+  }
+}
+
+// Expects memoryMutex to be held. The driver's figure is only as current as the last query, so
+// what the engine allocated or freed since then is applied on top, like VMA does.
+MemoryHeapUsage LiveDevice::heapUsage(uint32_t heap) const {
+  const HeapTally &tally = heaps[heap];
+
+  MemoryHeapUsage usage{};
+  usage.heapIndex = heap;
+  usage.flags = memoryProperties.memoryHeaps[heap].flags;
+  usage.size = memoryProperties.memoryHeaps[heap].size;
+  usage.budget = tally.budget;
+  usage.usage = tally.driverUsage + tally.allocated > tally.allocatedAtQuery
+                    ? tally.driverUsage + tally.allocated - tally.allocatedAtQuery
+                    : 0;
+  usage.allocated = tally.allocated;
+  usage.retiring = tally.retiring;
+  usage.allocationCount = tally.allocationCount;
+  return usage;
+}
+
+void LiveDevice::updateMemoryBudget() {
+  std::vector<std::pair<MemoryHeapUsage, VkDeviceSize>> overBudget;
+  std::vector<MemoryBudgetCallback> callbacks;
+  {
+    std::lock_guard<std::mutex> lock{memoryMutex};
+    queryMemoryBudget();
+
+    for (uint32_t i = 0; i < heaps.size(); i++) {
+      MemoryHeapUsage usage = heapUsage(i);
+      VkDeviceSize threshold =
+          static_cast<VkDeviceSize>(usage.budget * MEMORY_PRESSURE_THRESHOLD);
+      VkDeviceSize pressure = usage.usage > usage.retiring ? usage.usage - usage.retiring : 0;
+      if (pressure > threshold) {
+        overBudget.emplace_back(usage, pressure - threshold);
+      }
+    }
+    if (overBudget.empty()) {
+      return;
+    }
+
+    for (auto &entry : budgetCallbacks) {
+      callbacks.push_back(entry.second);
+    }
+  }
+
+  // Outside the lock: callbacks release resources, which retire and free memory
+  for (auto &[usage, excess] : overBudget) {
+    for (auto &callback : callbacks) {
+      callback(usage, excess);
+    }
+  }
+}
+
+std::vector<MemoryHeapUsage> LiveDevice::getMemoryUsage() {
+  std::lock_guard<std::mutex> lock{memoryMutex};
+  std::vector<MemoryHeapUsage> usage;
+  for (uint32_t i = 0; i < heaps.size(); i++) {
+    usage.push_back(heapUsage(i));
+  }
+  return usage;
+}
+
+uint32_t LiveDevice::addMemoryBudgetCallback(MemoryBudgetCallback callback) {
+  std::lock_guard<std::mutex> lock{memoryMutex};
+  budgetCallbacks.emplace_back(nextBudgetCallback, std::move(callback));
+  return nextBudgetCallback++;
+}
+
+void LiveDevice::removeMemoryBudgetCallback(uint32_t id) {
+  std::lock_guard<std::mutex> lock{memoryMutex};
+  budgetCallbacks.erase(
+      std::remove_if(
+          budgetCallbacks.begin(),
+          budgetCallbacks.end(),
+          [id](const auto &entry) { return entry.first == id; }),
+      budgetCallbacks.end());
+}
+
 void LiveDevice::createBuffer(
     VkDeviceSize size,
     VkBufferUsageFlags usage,
@@ -421,9 +748,7 @@ void LiveDevice::createBuffer(
   allocInfo.allocationSize = memRequirements.size;
   allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
-  }
+  allocateMemory(allocInfo, bufferMemory);
 
   vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
@@ -454,8 +779,8 @@ void LiveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  graphicsTimeline_->wait(graphicsTimeline_->submit(submitInfo));
+  collectGarbage();
 
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
@@ -516,13 +841,58 @@ void LiveDevice::createImageWithInfo(
   allocInfo.allocationSize = memRequirements.size;
   allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  allocateMemory(allocInfo, imageMemory);
 
   if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void LiveDevice::deferDestruction(std::function<void()> deleter) {
+  std::lock_guard<std::mutex> lock{deletionMutex};
+  if (recordingFrame) {
+    frameDeletions.push_back(std::move(deleter));
+  } else {
+    deletionQueue.emplace_back(graphicsTimeline_->nextValue(), std::move(deleter));
+  }
+}
+
+void LiveDevice::beginFrameDeletions() {
+  std::lock_guard<std::mutex> lock{deletionMutex};
+  recordingFrame = true;
+}
+
+// The frame's value is at least that of everything already queued, so the queue stays sorted
+void LiveDevice::submitFrameDeletions(uint64_t frameValue) {
+  std::lock_guard<std::mutex> lock{deletionMutex};
+  for (auto &deleter : frameDeletions) {
+    deletionQueue.emplace_back(frameValue, std::move(deleter));
+  }
+  frameDeletions.clear();
+  recordingFrame = false;
+}
+
+void LiveDevice::collectGarbage() {
+  std::vector<std::function<void()>> ready;
+  {
+    std::lock_guard<std::mutex> lock{deletionMutex};
+    uint64_t completed = graphicsTimeline_->completedValue();
+    while (!deletionQueue.empty() && deletionQueue.front().first <= completed) {
+      ready.push_back(std::move(deletionQueue.front().second));
+      deletionQueue.pop_front();
+    }
+  }
+
+  // Run outside the lock, deleters may release further resources
+  for (auto &deleter : ready) {
+    deleter();
+  }
+}
+
+void LiveDevice::cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo &renderingInfo) {
+  cmdBeginRendering_(commandBuffer, &renderingInfo);
+}
+
+void LiveDevice::cmdEndRendering(VkCommandBuffer commandBuffer) { cmdEndRendering_(commandBuffer); }
+
 }  // namespace lve
\ No newline at end of file
@@ -3,7 +3,12 @@
 #include "live_window.h"
 
 // std lib headers
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace live {
@@ -14,6 +19,38 @@ struct SwapChainSupportDetails {
   std::vector<VkPresentModeKHR> presentModes;
 };
 
+// Optional device features the engine enables when the physical device offers them.
+struct DeviceFeatureSupport {
+  bool timelineSemaphore = false;
+  bool descriptorIndexing = false;  // runtime sized, partially bound, update-after-bind image arrays
+  bool multiDrawIndirect = false;
+  bool drawIndirectFirstInstance = false;  // nonzero firstInstance in indirect draw commands
+  bool textureCompressionBC = false;    // BC1-7, desktop
+  bool textureCompressionETC2 = false;  // ETC2/EAC, mobile
+  bool dynamicRendering = false;  // Vulkan 1.3, or VK_KHR_dynamic_rendering on 1.2
+  bool memoryBudget = false;      // VK_EXT_memory_budget
+};
+
+// One memory heap as seen by the engine's accounting, see LiveDevice::getMemoryUsage.
+struct MemoryHeapUsage {
+  uint32_t heapIndex;
+  VkMemoryHeapFlags flags;
+  VkDeviceSize size;
+  // With VK_EXT_memory_budget what the driver reports for this process, including other APIs and
+  // driver internals, kept current between queries with the engine's own allocations. Without
+  // it, budget is a share of the heap size and usage is what the engine allocated.
+  VkDeviceSize budget;
+  VkDeviceSize usage;
+  VkDeviceSize allocated;  // by the engine, live or awaiting deferred destruction
+  VkDeviceSize retiring;   // of allocated, queued for deferred destruction
+  uint32_t allocationCount;
+};
+
+// Asked to release excess bytes of the heap. Runs from updateMemoryBudget, between frames.
+using MemoryBudgetCallback = std::function<void(const MemoryHeapUsage &heap, VkDeviceSize excess)>;
+
+class QueueTimeline;
+
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
@@ -44,12 +81,36 @@ class LiveDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  QueueTimeline &graphicsTimeline() { return *graphicsTimeline_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  bool supportsMemoryProperties(VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+  VkFormatProperties getFormatProperties(VkFormat format);
+
+  // Memory accounting. Every allocation the engine makes goes through allocateMemory and
+  // freeMemory, which keep a per-heap tally. Resources released through deferDestruction call
+  // retireMemory first, so memory that is already on its way out isn't evicted for twice.
+  static constexpr float DEFAULT_HEAP_BUDGET = 0.8f;        // share of a heap without VK_EXT_memory_budget
+  static constexpr float MEMORY_PRESSURE_THRESHOLD = 0.9f;  // share of the budget callbacks keep usage under
+
+  void allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory &memory);
+  void freeMemory(VkDeviceMemory memory);
+  void retireMemory(VkDeviceMemory memory);
+
+  // Refreshes the driver's budget and calls the budget callbacks for every heap whose usage, less
+  // what is retiring, is over MEMORY_PRESSURE_THRESHOLD of its budget. Call once per frame before
+  // recording; callbacks may release resources but should leave rebuilding to their own update.
+  void updateMemoryBudget();
+  // Every heap as of the last updateMemoryBudget, with the engine's allocations up to date
+  std::vector<MemoryHeapUsage> getMemoryUsage();
+
+  // Returns an ID for removeMemoryBudgetCallback
+  uint32_t addMemoryBudgetCallback(MemoryBudgetCallback callback);
+  void removeMemoryBudgetCallback(uint32_t id);
 
   // Buffer Helper Functions
   void createBuffer(
@@ -70,7 +131,22 @@ class LiveDevice {
       VkImage &image,
       VkDeviceMemory &imageMemory);
 
+  // Deferred destruction: the deleter runs once the graphics work submitted so far has completed,
+  // so resources released mid-frame never need a device wait. Between beginFrameDeletions and
+  // submitFrameDeletions deleters also wait for the frame's own submission, whatever single-time
+  // submits are made while it is recorded; outside a frame they wait for the next submission.
+  void deferDestruction(std::function<void()> deleter);
+  void collectGarbage();
+  void beginFrameDeletions();
+  void submitFrameDeletions(uint64_t frameValue);
+
+  // Core or KHR entry points, whichever the device was created with. Requires
+  // enabledFeatures.dynamicRendering.
+  void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo &renderingInfo);
+  void cmdEndRendering(VkCommandBuffer commandBuffer);
+
   VkPhysicalDeviceProperties properties;
+  DeviceFeatureSupport enabledFeatures;
 
  private:
   void createInstance();
@@ -79,6 +155,10 @@ class LiveDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void queryDeviceFeatures();
+  void loadDeviceFunctions();
+  void queryMemoryBudget();
+  MemoryHeapUsage heapUsage(uint32_t heap) const;
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -88,18 +168,57 @@ class LiveDevice {
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool supportsDeviceExtension(VkPhysicalDevice device, const char *extensionName);
+  // Both the instance and the physical device
+  bool supportsApiVersion(uint32_t version) const {
+    return instanceApiVersion >= version && properties.apiVersion >= version;
+  }
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
+  uint32_t instanceApiVersion = VK_API_VERSION_1_0;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   LiveWindow &window;
   VkCommandPool commandPool;
 
+  bool dynamicRenderingExtension = false;  // dynamic rendering through the KHR extension, not core
+  PFN_vkCmdBeginRendering cmdBeginRendering_ = nullptr;
+  PFN_vkCmdEndRendering cmdEndRendering_ = nullptr;
+
   VkDevice device_;
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  std::unique_ptr<QueueTimeline> graphicsTimeline_;
+
+  std::mutex deletionMutex;
+  std::deque<std::pair<uint64_t, std::function<void()>>> deletionQueue;
+  std::vector<std::function<void()>> frameDeletions;  // released while recording, value not known yet
+  bool recordingFrame = false;
+
+  struct Allocation {
+    uint32_t heap;
+    VkDeviceSize size;
+    bool retiring;
+  };
+
+  struct HeapTally {
+    VkDeviceSize budget = 0;
+    VkDeviceSize driverUsage = 0;      // at the last query
+    VkDeviceSize allocatedAtQuery = 0;
+    VkDeviceSize allocated = 0;
+    VkDeviceSize retiring = 0;
+    uint32_t allocationCount = 0;
+  };
+
+  // Guarded by memoryMutex; deferred deleters free from wherever collectGarbage runs
+  std::mutex memoryMutex;
+  VkPhysicalDeviceMemoryProperties memoryProperties{};
+  std::unordered_map<VkDeviceMemory, Allocation> allocations;
+  std::vector<HeapTally> heaps;
+  std::vector<std::pair<uint32_t, MemoryBudgetCallback>> budgetCallbacks;
+  uint32_t nextBudgetCallback = 0;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -1,6 +1,8 @@
 #include "engine_swap_chain.h"
+#include "queue_timeline.h"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -11,24 +13,36 @@
 
 namespace live {
 
-LiveSwapChain::LiveSwapChain(LiveDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+LiveSwapChain::LiveSwapChain(LiveDevice &deviceRef, VkExtent2D extent, PresentModePolicy policy)
+    : presentModePolicy{policy}, device{deviceRef}, windowExtent{extent} {
     init();
 }
 
-LiveSwapChain::LiveSwapChain(LiveDevice& deviceRef, VkExtent2D extent, std::shared_ptr<LiveSwapChain> previous)
-    : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } {
+LiveSwapChain::LiveSwapChain(
+    LiveDevice& deviceRef, VkExtent2D extent, std::shared_ptr<LiveSwapChain> previous, PresentModePolicy policy)
+    : presentModePolicy{ policy }, device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } {
     init();
 
+    // Frame slots keep counting across swap chains so the next frame still waits on the work
+    // submitted through the previous one.
+    inFlightValues = oldSwapChain->inFlightValues;
+    currentFrame = oldSwapChain->currentFrame;
+
     oldSwapChain = nullptr;
 }
 
 void LiveSwapChain::init() {
+    dynamicRendering = device.enabledFeatures.dynamicRendering;
+
     createSwapChain();
     createImageViews();
-    createRenderPass();
+    if (!dynamicRendering) {
+        createRenderPass();
+    }
     createDepthResources();
-    createFramebuffers();
+    if (!dynamicRendering) {
+        createFramebuffers();
+    }
     createSyncObjects();
 }
 
@@ -46,30 +60,26 @@ LiveSwapChain::~LiveSwapChain() {
   for (int i = 0; i < depthImages.size(); i++) {
     vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
     vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+    device.freeMemory(depthImageMemorys[i]);
   }
 
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  if (renderPass != VK_NULL_HANDLE) {
+    vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  }
 
   // cleanup synchronization objects
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
   }
 }
 
 VkResult LiveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      device.device(),
-      1,
-      &inFlightFences[currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
+  device.graphicsTimeline().wait(inFlightValues[currentFrame]);
 
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
@@ -84,10 +94,7 @@ VkResult LiveSwapChain::acquireNextImage(uint32_t *imageIndex) {
 
 VkResult LiveSwapChain::submitCommandBuffers(
     const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-  if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-  }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+  device.graphicsTimeline().wait(imagesInFlight[*imageIndex]);
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -105,11 +112,10 @@ VkResult LiveSwapChain::submitCommandBuffers(
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
+  uint64_t frameValue = device.graphicsTimeline().submit(submitInfo);
+  inFlightValues[currentFrame] = frameValue;
+  imagesInFlight[*imageIndex] = frameValue;
+  submittedFrameValue = frameValue;
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -134,7 +140,7 @@ void LiveSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
   uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -213,8 +219,13 @@ void LiveSwapChain::createImageViews() {
 }
 
 void LiveSwapChain::createRenderPass() {
+  VkFormat depthFormat = findDepthFormat();
+  if (adoptRenderPass(depthFormat)) {
+    return;
+  }
+
   VkAttachmentDescription depthAttachment{};
-  depthAttachment.format = findDepthFormat();
+  depthAttachment.format = depthFormat;
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -241,32 +252,51 @@ void LiveSwapChain::createRenderPass() {
   colorAttachmentRef.attachment = 0;
   colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-  VkSubpassDescription subpass = {};
-  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-  subpass.colorAttachmentCount = 1;
-  subpass.pColorAttachments = &colorAttachmentRef;
-  subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-  VkSubpassDependency dependency = {};
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.srcAccessMask = 0;
-  dependency.srcStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.dstSubpass = 0;
-  dependency.dstStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.dstAccessMask =
-      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  std::array<VkSubpassDescription, 2> subpasses = {};
+  subpasses[DEPTH_PREPASS_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[DEPTH_PREPASS_SUBPASS].pDepthStencilAttachment = &depthAttachmentRef;
+
+  subpasses[COLOR_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[COLOR_SUBPASS].colorAttachmentCount = 1;
+  subpasses[COLOR_SUBPASS].pColorAttachments = &colorAttachmentRef;
+  subpasses[COLOR_SUBPASS].pDepthStencilAttachment = &depthAttachmentRef;
+
+  std::array<VkSubpassDependency, 3> dependencies = {};
+
+  // A frame slot's depth image was last written by the slot's previous frame; order those writes too
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstSubpass = DEPTH_PREPASS_SUBPASS;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = 0;
+  dependencies[1].dstSubpass = COLOR_SUBPASS;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  // The color subpass tests against (and without a pre-pass, writes) the pre-pass depth
+  dependencies[2].srcSubpass = DEPTH_PREPASS_SUBPASS;
+  dependencies[2].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[2].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[2].dstSubpass = COLOR_SUBPASS;
+  dependencies[2].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[2].dstAccessMask =
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
   std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
   VkRenderPassCreateInfo renderPassInfo = {};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
   renderPassInfo.pAttachments = attachments.data();
-  renderPassInfo.subpassCount = 1;
-  renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses = subpasses.data();
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
@@ -274,9 +304,11 @@ void LiveSwapChain::createRenderPass() {
 }
 
 void LiveSwapChain::createFramebuffers() {
-  swapChainFramebuffers.resize(imageCount());
-  for (size_t i = 0; i < imageCount(); i++) {
-    std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
+  swapChainFramebuffers.resize(MAX_FRAMES_IN_FLIGHT * imageCount());
+  for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
+    size_t frame = i / imageCount();
+    size_t image = i % imageCount();
+    std::array<VkImageView, 2> attachments = {swapChainImageViews[image], depthImageViews[frame]};
 
     VkExtent2D swapChainExtent = getSwapChainExtent();
     VkFramebufferCreateInfo framebufferInfo = {};
@@ -301,32 +333,48 @@ void LiveSwapChain::createFramebuffers() {
 void LiveSwapChain::createDepthResources() {
   VkFormat depthFormat = findDepthFormat();
   swapChainDepthFormat = depthFormat;
+
   VkExtent2D swapChainExtent = getSwapChainExtent();
+  depthExtent.width = (swapChainExtent.width + DEPTH_SIZE_CLASS - 1) / DEPTH_SIZE_CLASS * DEPTH_SIZE_CLASS;
+  depthExtent.height = (swapChainExtent.height + DEPTH_SIZE_CLASS - 1) / DEPTH_SIZE_CLASS * DEPTH_SIZE_CLASS;
+
+  if (adoptDepthResources(depthExtent)) {
+    return;
+  }
+
+  // Depth is cleared on load and discarded on store, so on tiled GPUs it can live entirely in tile
+  // memory: as a transient attachment backed by lazily allocated memory it may never be committed.
+  VkMemoryPropertyFlags depthMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  if (device.supportsMemoryProperties(
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+    depthMemoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+  }
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
+  depthImages.resize(MAX_FRAMES_IN_FLIGHT);
+  depthImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
+  depthImageViews.resize(MAX_FRAMES_IN_FLIGHT);
 
   for (int i = 0; i < depthImages.size(); i++) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = swapChainExtent.width;
-    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.width = depthExtent.width;
+    imageInfo.extent.height = depthExtent.height;
     imageInfo.extent.depth = 1;
     imageInfo.mipLevels = 1;
     imageInfo.arrayLayers = 1;
     imageInfo.format = depthFormat;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    imageInfo.usage =
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
     device.createImageWithInfo(
         imageInfo,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        depthMemoryProperties,
         depthImages[i],
         depthImageMemorys[i]);
 
@@ -350,27 +398,60 @@ void LiveSwapChain::createDepthResources() {
 void LiveSwapChain::createSyncObjects() {
   imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  inFlightValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
+  imagesInFlight.resize(imageCount(), 0);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            VK_SUCCESS) {
       throw std::runtime_error("failed to create synchronization objects for a frame!");
     }
   }
 }
 
+// Takes over the previous swap chain's render pass when the attachment formats are unchanged, which
+// also keeps pipelines created against it valid.
+bool LiveSwapChain::adoptRenderPass(VkFormat depthFormat) {
+  if (oldSwapChain == nullptr || oldSwapChain->renderPass == VK_NULL_HANDLE ||
+      oldSwapChain->swapChainImageFormat != swapChainImageFormat ||
+      oldSwapChain->swapChainDepthFormat != depthFormat) {
+    return false;
+  }
+
+  renderPass = oldSwapChain->renderPass;
+  oldSwapChain->renderPass = VK_NULL_HANDLE;
+  return true;
+}
+
+// Takes over the previous swap chain's depth images when they fall in the same size class.
+bool LiveSwapChain::adoptDepthResources(VkExtent2D classExtent) {
+  if (oldSwapChain == nullptr || oldSwapChain->depthImages.size() != MAX_FRAMES_IN_FLIGHT ||
+      oldSwapChain->swapChainDepthFormat != swapChainDepthFormat ||
+      oldSwapChain->depthExtent.width != classExtent.width ||
+      oldSwapChain->depthExtent.height != classExtent.height) {
+    return false;
+  }
+
+  depthImages = std::move(oldSwapChain->depthImages);
+  depthImageMemorys = std::move(oldSwapChain->depthImageMemorys);
+  depthImageViews = std::move(oldSwapChain->depthImageViews);
+  oldSwapChain->depthImages.clear();
+  oldSwapChain->depthImageMemorys.clear();
+  oldSwapChain->depthImageViews.clear();
+  return true;
+}
+
+void LiveSwapChain::retireDepthMemory() {
+  for (auto memory : depthImageMemorys) {
+    device.retireMemory(memory);
+  }
+}
+
 VkSurfaceFormatKHR LiveSwapChain::chooseSwapSurfaceFormat(
     const std::vector<VkSurfaceFormatKHR> &availableFormats) {
   for (const auto &availableFormat : availableFormats) {
@@ -384,21 +465,29 @@ VkSurfaceFormatKHR LiveSwapChain::chooseSwapSurfaceFormat(
 }
 
 VkPresentModeKHR LiveSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-  //for (const auto &availablePresentMode : availablePresentModes) {
-  //  if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-  //    std::cout << "Present mode: Mailbox" << std::endl;
-  //    return availablePresentMode;
-  //  }
-  //}
-
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  // }
-
-  //std::cout << "Present mode: V-Sync" << std::endl;
+  std::vector<VkPresentModeKHR> preferred;
+  switch (presentModePolicy) {
+    case PresentModePolicy::LowLatency:
+      preferred = {VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
+    case PresentModePolicy::Uncapped:
+      preferred = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
+    case PresentModePolicy::Adaptive:
+      preferred = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+      break;
+    case PresentModePolicy::VSync:
+      break;
+  }
+
+  for (auto mode : preferred) {
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) !=
+        availablePresentModes.end()) {
+      return mode;
+    }
+  }
+
+  // FIFO is the only mode the spec guarantees
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -12,23 +12,63 @@
 
 namespace live {
 
+// Caller preference for how presentation is paced. Each policy falls back to FIFO (always
+// supported) when the surface does not offer the requested mode.
+enum class PresentModePolicy {
+  VSync,       // FIFO
+  LowLatency,  // MAILBOX, then FIFO
+  Uncapped,    // IMMEDIATE, then MAILBOX, then FIFO
+  Adaptive     // FIFO_RELAXED, then FIFO
+};
+
 class LiveSwapChain {
  public:
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-  LiveSwapChain(LiveDevice& deviceRef, VkExtent2D windowExtent);
-  LiveSwapChain(LiveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LiveSwapChain> previous);
+  // Depth attachments are allocated rounded up to this granularity so that small resizes can keep
+  // using the previous swap chain's depth images.
+  static constexpr uint32_t DEPTH_SIZE_CLASS = 256;
+
+  // The render pass starts with a depth-only subpass for an optional depth pre-pass; it is simply
+  // left empty when the pre-pass is off. Color is drawn in the second subpass.
+  static constexpr uint32_t DEPTH_PREPASS_SUBPASS = 0;
+  static constexpr uint32_t COLOR_SUBPASS = 1;
+
+  // Layouts the images are in while the swap chain is rendered to with dynamic rendering
+  static constexpr VkImageLayout COLOR_ATTACHMENT_LAYOUT = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  static constexpr VkImageLayout DEPTH_ATTACHMENT_LAYOUT = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  LiveSwapChain(LiveDevice& deviceRef, VkExtent2D windowExtent, PresentModePolicy policy = PresentModePolicy::VSync);
+  LiveSwapChain(
+      LiveDevice &deviceRef,
+      VkExtent2D windowExtent,
+      std::shared_ptr<LiveSwapChain> previous,
+      PresentModePolicy policy = PresentModePolicy::VSync);
   ~LiveSwapChain();
 
   LiveSwapChain(const LiveSwapChain &) = delete;
   LiveSwapChain &operator=(const LiveSwapChain &) = delete;
 
-  VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
+  // Framebuffer of the swap chain image for the frame slot being recorded, i.e. the one the last
+  // acquireNextImage waited on. Each slot has its own depth image, so there is one framebuffer per
+  // slot and image.
+  VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[currentFrame * imageCount() + index]; }
+  // VK_NULL_HANDLE with dynamic rendering
   VkRenderPass getRenderPass() { return renderPass; }
+  // With dynamic rendering there are no render pass or framebuffers: the images are rendered to
+  // directly, so recreating the swap chain creates nothing that pipelines or recording depend on.
+  bool usesDynamicRendering() { return dynamicRendering; }
+  VkImage getImage(int index) { return swapChainImages[index]; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  // Depth attachment of the frame slot being recorded
+  VkImage getDepthImage() { return depthImages[currentFrame]; }
+  VkImageView getDepthImageView() { return depthImageViews[currentFrame]; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
+  VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
+  VkPresentModeKHR getPresentMode() { return presentMode; }
+  PresentModePolicy getPresentModePolicy() { return presentModePolicy; }
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
 
@@ -39,11 +79,18 @@ class LiveSwapChain {
 
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+  // Graphics timeline value the last submitCommandBuffers signals
+  uint64_t getSubmittedFrameValue() { return submittedFrameValue; }
 
   bool compareSwapFormats(const LiveSwapChain& swapChain) {
       return swapChain.swapChainDepthFormat == swapChainDepthFormat && swapChain.swapChainImageFormat == swapChainImageFormat;
   }
 
+  // Call when queueing a replaced swap chain for deferred destruction: its depth memory stops
+  // counting against the heap budgets, see LiveDevice::retireMemory. Depth images adopted by the
+  // new swap chain are no longer this one's.
+  void retireDepthMemory();
+
 private:
     void init();
     void createSwapChain();
@@ -52,6 +99,8 @@ private:
     void createRenderPass();
     void createFramebuffers();
     void createSyncObjects();
+    bool adoptRenderPass(VkFormat depthFormat);
+    bool adoptDepthResources(VkExtent2D classExtent);
 
     // Helper functions
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -63,10 +112,16 @@ private:
     VkFormat                       swapChainImageFormat;
     VkFormat                       swapChainDepthFormat;
     VkExtent2D                     swapChainExtent;
+    VkPresentModeKHR               presentMode;
+    PresentModePolicy              presentModePolicy;
     
-    std::vector<VkFramebuffer>     swapChainFramebuffers;
-    VkRenderPass                   renderPass;
+    bool                           dynamicRendering = false;
+    std::vector<VkFramebuffer>     swapChainFramebuffers;  // [frame slot][image]
+    VkRenderPass                   renderPass = VK_NULL_HANDLE;
     
+    // One depth image per frame slot: depth is never read after the render pass, so only the
+    // frames that can be in flight at once need their own
+    VkExtent2D                     depthExtent;
     std::vector<VkImage>           depthImages;
     std::vector<VkDeviceMemory>    depthImageMemorys;
     std::vector<VkImageView>       depthImageViews;
@@ -81,10 +136,13 @@ private:
     
     std::vector<VkSemaphore>       imageAvailableSemaphores;
     std::vector<VkSemaphore>       renderFinishedSemaphores;
-    std::vector<VkFence>           inFlightFences;
-    std::vector<VkFence>           imagesInFlight;
+
+    // Graphics timeline values signaled by the last submission of each frame slot / image
+    std::vector<uint64_t>          inFlightValues;
+    std::vector<uint64_t>          imagesInFlight;
     
     size_t currentFrame = 0;
+    uint64_t submittedFrameValue = 0;
 };
 
 }  // namespace lve
@@ -0,0 +1,87 @@
+#include "frame_allocator.h"
+#include "engine_swap_chain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace live {
+	FrameAllocator::FrameAllocator(LiveDevice& device, VkDeviceSize capacity) : liveDevice{ device } {
+		const auto& limits = liveDevice.properties.limits;
+		uniformAlignment = limits.minUniformBufferOffsetAlignment;
+		storageAlignment = limits.minStorageBufferOffsetAlignment;
+
+		VkMemoryPropertyFlags memoryProperties = chooseMemoryProperties(liveDevice);
+		coherent = (memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+		// Frame regions must start on offsets valid for every use, including non-coherent flush ranges
+		VkDeviceSize regionAlignment = std::max({ uniformAlignment, storageAlignment, limits.nonCoherentAtomSize });
+
+		buffer = std::make_unique<Buffer>(
+			liveDevice,
+			capacity,
+			LiveSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+				VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			memoryProperties,
+			regionAlignment
+		);
+		buffer->map();
+
+		frameCapacity = buffer->getBufferSize() / LiveSwapChain::MAX_FRAMES_IN_FLIGHT;
+	}
+
+	FrameAllocator::~FrameAllocator() {}
+
+	VkMemoryPropertyFlags FrameAllocator::chooseMemoryProperties(LiveDevice& device) {
+		const VkMemoryPropertyFlags candidates[] = {
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		};
+
+		for (auto properties : candidates) {
+			if (device.supportsMemoryProperties(properties)) {
+				return properties;
+			}
+		}
+
+		return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+
+	// The frame's previous contents are no longer read by the GPU once Renderer::beginFrame has
+	// waited on the frame slot, so the region can be handed out again from the start.
+	void FrameAllocator::beginFrame(int frameIndex) {
+		frameBase = frameCapacity * frameIndex;
+		frameOffset = 0;
+	}
+
+	FrameAllocator::Allocation FrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+		VkDeviceSize offset = frameOffset;
+		if (alignment > 1) {
+			offset = (offset + alignment - 1) & ~(alignment - 1);
+		}
+
+		if (offset + size > frameCapacity) {
+			throw std::runtime_error("Frame allocator is out of space for this frame.");
+		}
+
+		frameOffset = offset + size;
+
+		Allocation allocation{};
+		allocation.data = static_cast<char*>(buffer->getMappedMemory()) + frameBase + offset;
+		allocation.offset = static_cast<uint32_t>(frameBase + offset);
+		allocation.size = size;
+		return allocation;
+	}
+
+	void FrameAllocator::flush() {
+		if (coherent || frameOffset == 0) {
+			return;
+		}
+
+		VkDeviceSize atomSize = liveDevice.properties.limits.nonCoherentAtomSize;
+		VkDeviceSize flushSize = (frameOffset + atomSize - 1) & ~(atomSize - 1);
+		buffer->flush(std::min(flushSize, frameCapacity), frameBase);
+	}
+}
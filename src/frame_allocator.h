@@ -0,0 +1,61 @@
+#pragma once
+
+#include "buffer.h"
+#include "engine_device.h"
+
+#include <memory>
+
+
+namespace live {
+	// Linear allocator over one persistently mapped buffer split into a region per frame in flight.
+	// Systems push arbitrary per-frame data (uniforms, per-draw storage, indirect commands) and bind it
+	// through dynamic offsets; the whole region is recycled once its frame slot comes around again.
+	// Memory is host coherent when the device offers it (device local first), otherwise writes are
+	// flushed explicitly at the end of the frame.
+	class FrameAllocator {
+	public:
+		struct Allocation {
+			void*        data;
+			uint32_t     offset;  // from the start of the buffer, usable as a dynamic offset
+			VkDeviceSize size;
+		};
+
+		FrameAllocator(LiveDevice& device, VkDeviceSize frameCapacity);
+		~FrameAllocator();
+
+		FrameAllocator(const FrameAllocator&) = delete;
+		FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+		void beginFrame(int frameIndex);
+		void flush();
+
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+		Allocation allocateUniform(VkDeviceSize size) { return allocate(size, uniformAlignment); }
+		Allocation allocateStorage(VkDeviceSize size) { return allocate(size, storageAlignment); }
+		Allocation allocateIndirect(VkDeviceSize size) { return allocate(size, 4); }
+
+		template <typename T>
+		Allocation pushUniform(const T& value) {
+			Allocation allocation = allocateUniform(sizeof(T));
+			*static_cast<T*>(allocation.data) = value;
+			return allocation;
+		}
+
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		bool isCoherent() const { return coherent; }
+		VkDeviceSize getUsedBytes() const { return frameOffset; }
+
+	private:
+		static VkMemoryPropertyFlags chooseMemoryProperties(LiveDevice& device);
+
+		LiveDevice&             liveDevice;
+		std::unique_ptr<Buffer> buffer;
+		bool                    coherent;
+
+		VkDeviceSize            uniformAlignment;
+		VkDeviceSize            storageAlignment;
+		VkDeviceSize            frameCapacity;
+		VkDeviceSize            frameBase = 0;
+		VkDeviceSize            frameOffset = 0;
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "camera.h"
+#include "frame_allocator.h"
 
 #include <vulkan/vulkan.h>
 
@@ -11,5 +12,8 @@ namespace live {
 		float frameTime;
 		VkCommandBuffer commandBuffer;
 		Camera& camera;
+		VkDescriptorSet globalDescriptorSet;
+		uint32_t globalUniformOffset;  // dynamic offset of this frame's global UBO
+		FrameAllocator& frameAllocator;
 	};
 }
\ No newline at end of file
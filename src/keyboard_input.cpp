@@ -36,3 +36,11 @@ void live::KeyboardInputController::moveInPlaneXZ(GLFWwindow* window, float dt,
 		object.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
 	}
 }
+
+bool live::KeyboardInputController::consumeKeyPress(GLFWwindow* window, int key) {
+	bool pressed = glfwGetKey(window, key) == GLFW_PRESS;
+	bool& held = keysHeld[key];
+	bool firstPoll = pressed && !held;
+	held = pressed;
+	return firstPoll;
+}
@@ -3,6 +3,8 @@
 #include "object.h"
 #include "live_window.h"
 
+#include <unordered_map>
+
 
 namespace live {
 	class KeyboardInputController {
@@ -18,12 +20,19 @@ namespace live {
 			int lookRight = GLFW_KEY_RIGHT;
 			int lookUp = GLFW_KEY_UP;
 			int lookDown = GLFW_KEY_DOWN;
+			int toggleDepthPrepass = GLFW_KEY_P;
+			int printMemoryUsage = GLFW_KEY_M;
 		};
 
 		void moveInPlaneXZ(GLFWwindow* window, float dt, Object& object);
+		// True once per press: on the first poll that sees the key down after it was released
+		bool consumeKeyPress(GLFWwindow* window, int key);
 
 		KeyMappings keys{};
 		float moveSpeed{ 3.0f };
 		float lookSpeed{ 1.5f };
+
+	private:
+		std::unordered_map<int, bool> keysHeld{};
 	};
 }
@@ -0,0 +1,232 @@
+#include "live_descriptors.h"
+
+#include <cassert>
+#include <stdexcept>
+
+
+namespace live {
+
+	// *************** Descriptor Set Layout Builder *********************
+
+	LiveDescriptorSetLayout::Builder& LiveDescriptorSetLayout::Builder::addBinding(
+		uint32_t binding,
+		VkDescriptorType descriptorType,
+		VkShaderStageFlags stageFlags,
+		uint32_t count,
+		VkDescriptorBindingFlags flags) {
+		assert(bindings.count(binding) == 0 && "Binding already in use");
+
+		VkDescriptorSetLayoutBinding layoutBinding{};
+		layoutBinding.binding         = binding;
+		layoutBinding.descriptorType  = descriptorType;
+		layoutBinding.descriptorCount = count;
+		layoutBinding.stageFlags      = stageFlags;
+		bindings[binding] = layoutBinding;
+
+		if (flags != 0) {
+			bindingFlags[binding] = flags;
+		}
+		return *this;
+	}
+
+	LiveDescriptorSetLayout::Builder& LiveDescriptorSetLayout::Builder::setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags) {
+		layoutFlags = flags;
+		return *this;
+	}
+
+	std::unique_ptr<LiveDescriptorSetLayout> LiveDescriptorSetLayout::Builder::build() const {
+		return std::make_unique<LiveDescriptorSetLayout>(liveDevice, bindings, bindingFlags, layoutFlags);
+	}
+
+	// *************** Descriptor Set Layout *********************
+
+	LiveDescriptorSetLayout::LiveDescriptorSetLayout(
+		LiveDevice& device,
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+		std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags,
+		VkDescriptorSetLayoutCreateFlags layoutFlags)
+		: liveDevice{ device }, bindings{ bindings } {
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+		std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+		for (auto& kv : bindings) {
+			setLayoutBindings.push_back(kv.second);
+			setLayoutBindingFlags.push_back(bindingFlags.count(kv.first) ? bindingFlags.at(kv.first) : 0);
+		}
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount  = static_cast<uint32_t>(setLayoutBindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+		descriptorSetLayoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descriptorSetLayoutInfo.pNext        = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+		descriptorSetLayoutInfo.flags        = layoutFlags;
+		descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+		descriptorSetLayoutInfo.pBindings    = setLayoutBindings.data();
+
+		if (vkCreateDescriptorSetLayout(liveDevice.device(), &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create descriptor set layout.");
+		}
+	}
+
+	LiveDescriptorSetLayout::~LiveDescriptorSetLayout() {
+		vkDestroyDescriptorSetLayout(liveDevice.device(), descriptorSetLayout, nullptr);
+	}
+
+	// *************** Descriptor Pool Builder *********************
+
+	LiveDescriptorPool::Builder& LiveDescriptorPool::Builder::addPoolSize(VkDescriptorType descriptorType, uint32_t count) {
+		poolSizes.push_back({ descriptorType, count });
+		return *this;
+	}
+
+	LiveDescriptorPool::Builder& LiveDescriptorPool::Builder::setPoolFlags(VkDescriptorPoolCreateFlags flags) {
+		poolFlags = flags;
+		return *this;
+	}
+
+	LiveDescriptorPool::Builder& LiveDescriptorPool::Builder::setMaxSets(uint32_t count) {
+		maxSets = count;
+		return *this;
+	}
+
+	std::unique_ptr<LiveDescriptorPool> LiveDescriptorPool::Builder::build() const {
+		return std::make_unique<LiveDescriptorPool>(liveDevice, maxSets, poolFlags, poolSizes);
+	}
+
+	// *************** Descriptor Pool *********************
+
+	LiveDescriptorPool::LiveDescriptorPool(
+		LiveDevice& device,
+		uint32_t maxSets,
+		VkDescriptorPoolCreateFlags poolFlags,
+		const std::vector<VkDescriptorPoolSize>& poolSizes)
+		: liveDevice{ device } {
+		VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+		descriptorPoolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		descriptorPoolInfo.pPoolSizes    = poolSizes.data();
+		descriptorPoolInfo.maxSets       = maxSets;
+		descriptorPoolInfo.flags         = poolFlags;
+
+		if (vkCreateDescriptorPool(liveDevice.device(), &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create descriptor pool.");
+		}
+	}
+
+	LiveDescriptorPool::~LiveDescriptorPool() {
+		VkDevice device = liveDevice.device();
+		VkDescriptorPool pool = descriptorPool;
+		liveDevice.deferDestruction([device, pool]() { vkDestroyDescriptorPool(device, pool, nullptr); });
+	}
+
+	bool LiveDescriptorPool::allocateDescriptorSet(
+		const VkDescriptorSetLayout descriptorSetLayout,
+		VkDescriptorSet& descriptor,
+		uint32_t variableDescriptorCount) const {
+		VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+		variableCountInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+		variableCountInfo.descriptorSetCount = 1;
+		variableCountInfo.pDescriptorCounts  = &variableDescriptorCount;
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool     = descriptorPool;
+		allocInfo.pSetLayouts        = &descriptorSetLayout;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pNext              = variableDescriptorCount > 0 ? &variableCountInfo : nullptr;
+
+		return vkAllocateDescriptorSets(liveDevice.device(), &allocInfo, &descriptor) == VK_SUCCESS;
+	}
+
+	void LiveDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const {
+		vkFreeDescriptorSets(
+			liveDevice.device(),
+			descriptorPool,
+			static_cast<uint32_t>(descriptors.size()),
+			descriptors.data());
+	}
+
+	void LiveDescriptorPool::resetPool() {
+		vkResetDescriptorPool(liveDevice.device(), descriptorPool, 0);
+	}
+
+	// *************** Descriptor Writer *********************
+
+	LiveDescriptorWriter::LiveDescriptorWriter(LiveDescriptorSetLayout& setLayout, LiveDescriptorPool& pool)
+		: setLayout{ setLayout }, pool{ pool } {}
+
+	LiveDescriptorWriter& LiveDescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
+		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+		auto& bindingDescription = setLayout.bindings[binding];
+
+		assert(bindingDescription.descriptorCount == 1 && "Binding single descriptor info, but binding expects multiple");
+
+		VkWriteDescriptorSet write{};
+		write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.descriptorType  = bindingDescription.descriptorType;
+		write.dstBinding      = binding;
+		write.pBufferInfo     = bufferInfo;
+		write.descriptorCount = 1;
+
+		writes.push_back(write);
+		return *this;
+	}
+
+	LiveDescriptorWriter& LiveDescriptorWriter::writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo) {
+		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+		auto& bindingDescription = setLayout.bindings[binding];
+
+		assert(bindingDescription.descriptorCount == 1 && "Binding single descriptor info, but binding expects multiple");
+
+		VkWriteDescriptorSet write{};
+		write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.descriptorType  = bindingDescription.descriptorType;
+		write.dstBinding      = binding;
+		write.pImageInfo      = imageInfo;
+		write.descriptorCount = 1;
+
+		writes.push_back(write);
+		return *this;
+	}
+
+	LiveDescriptorWriter& LiveDescriptorWriter::writeImageArrayElement(
+		uint32_t binding, uint32_t arrayElement, VkDescriptorImageInfo* imageInfo) {
+		assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+		auto& bindingDescription = setLayout.bindings[binding];
+
+		assert(arrayElement < bindingDescription.descriptorCount && "Array element out of range for binding");
+
+		VkWriteDescriptorSet write{};
+		write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.descriptorType  = bindingDescription.descriptorType;
+		write.dstBinding      = binding;
+		write.dstArrayElement = arrayElement;
+		write.pImageInfo      = imageInfo;
+		write.descriptorCount = 1;
+
+		writes.push_back(write);
+		return *this;
+	}
+
+	bool LiveDescriptorWriter::build(VkDescriptorSet& set, uint32_t variableDescriptorCount) {
+		if (!pool.allocateDescriptorSet(setLayout.getDescriptorSetLayout(), set, variableDescriptorCount)) {
+			return false;
+		}
+
+		overwrite(set);
+		return true;
+	}
+
+	void LiveDescriptorWriter::overwrite(VkDescriptorSet& set) {
+		for (auto& write : writes) {
+			write.dstSet = set;
+		}
+
+		vkUpdateDescriptorSets(pool.liveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
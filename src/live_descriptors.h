@@ -0,0 +1,114 @@
+#pragma once
+
+#include "engine_device.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace live {
+	class LiveDescriptorSetLayout {
+	public:
+		class Builder {
+		public:
+			Builder(LiveDevice& device) : liveDevice{ device } {}
+
+			Builder& addBinding(
+				uint32_t binding,
+				VkDescriptorType descriptorType,
+				VkShaderStageFlags stageFlags,
+				uint32_t count = 1,
+				VkDescriptorBindingFlags flags = 0);
+			Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
+
+			std::unique_ptr<LiveDescriptorSetLayout> build() const;
+
+		private:
+			LiveDevice&                                                liveDevice;
+			std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+			std::unordered_map<uint32_t, VkDescriptorBindingFlags>     bindingFlags{};
+			VkDescriptorSetLayoutCreateFlags                           layoutFlags = 0;
+		};
+
+		LiveDescriptorSetLayout(
+			LiveDevice& device,
+			std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+			std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags = {},
+			VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
+		~LiveDescriptorSetLayout();
+
+		LiveDescriptorSetLayout(const LiveDescriptorSetLayout&) = delete;
+		LiveDescriptorSetLayout& operator=(const LiveDescriptorSetLayout&) = delete;
+
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+
+	private:
+		LiveDevice&                                                liveDevice;
+		VkDescriptorSetLayout                                      descriptorSetLayout;
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+
+		friend class LiveDescriptorWriter;
+	};
+
+	class LiveDescriptorPool {
+	public:
+		class Builder {
+		public:
+			Builder(LiveDevice& device) : liveDevice{ device } {}
+
+			Builder& addPoolSize(VkDescriptorType descriptorType, uint32_t count);
+			Builder& setPoolFlags(VkDescriptorPoolCreateFlags flags);
+			Builder& setMaxSets(uint32_t count);
+
+			std::unique_ptr<LiveDescriptorPool> build() const;
+
+		private:
+			LiveDevice&                       liveDevice;
+			std::vector<VkDescriptorPoolSize> poolSizes{};
+			uint32_t                          maxSets = 1000;
+			VkDescriptorPoolCreateFlags       poolFlags = 0;
+		};
+
+		LiveDescriptorPool(
+			LiveDevice& device,
+			uint32_t maxSets,
+			VkDescriptorPoolCreateFlags poolFlags,
+			const std::vector<VkDescriptorPoolSize>& poolSizes);
+		~LiveDescriptorPool();
+
+		LiveDescriptorPool(const LiveDescriptorPool&) = delete;
+		LiveDescriptorPool& operator=(const LiveDescriptorPool&) = delete;
+
+		// variableDescriptorCount sizes the layout's VARIABLE_DESCRIPTOR_COUNT binding, if it has one
+		bool allocateDescriptorSet(
+			const VkDescriptorSetLayout descriptorSetLayout,
+			VkDescriptorSet& descriptor,
+			uint32_t variableDescriptorCount = 0) const;
+		void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
+		void resetPool();
+
+	private:
+		LiveDevice&      liveDevice;
+		VkDescriptorPool descriptorPool;
+
+		friend class LiveDescriptorWriter;
+	};
+
+	class LiveDescriptorWriter {
+	public:
+		LiveDescriptorWriter(LiveDescriptorSetLayout& setLayout, LiveDescriptorPool& pool);
+
+		LiveDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
+		LiveDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
+		LiveDescriptorWriter& writeImageArrayElement(uint32_t binding, uint32_t arrayElement, VkDescriptorImageInfo* imageInfo);
+
+		bool build(VkDescriptorSet& set, uint32_t variableDescriptorCount = 0);
+		void overwrite(VkDescriptorSet& set);
+
+	private:
+		LiveDescriptorSetLayout&          setLayout;
+		LiveDescriptorPool&               pool;
+		std::vector<VkWriteDescriptorSet> writes;
+	};
+}
@@ -17,9 +17,16 @@ live::LivePipeline::LivePipeline(
 }
 
 live::LivePipeline::~LivePipeline() {
-	vkDestroyShaderModule(liveDevice.device(), vertShaderModule, nullptr);
-	vkDestroyShaderModule(liveDevice.device(), fragShaderModule, nullptr);
-	vkDestroyPipeline(liveDevice.device(), graphicsPipeline, nullptr);
+	VkDevice device = liveDevice.device();
+	VkPipeline pipeline = graphicsPipeline;
+	VkShaderModule vertModule = vertShaderModule;
+	VkShaderModule fragModule = fragShaderModule;
+
+	liveDevice.deferDestruction([device, pipeline, vertModule, fragModule]() {
+		vkDestroyShaderModule(device, vertModule, nullptr);
+		vkDestroyShaderModule(device, fragModule, nullptr);
+		vkDestroyPipeline(device, pipeline, nullptr);
+	});
 }
 
 void live::LivePipeline::bind(VkCommandBuffer commandBuffer) {
@@ -93,6 +100,9 @@ void live::LivePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInf
 	configInfo.dynamicStateInfo.pDynamicStates    = configInfo.dynamicStateEnables.data();
 	configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 	configInfo.dynamicStateInfo.flags             = 0;
+
+	configInfo.bindingDescriptions   = Model::Vertex::getBindingDescriptions();
+	configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
 }
 
 std::vector<char> live::LivePipeline::readFile(const std::string& filePath) {
@@ -115,13 +125,17 @@ std::vector<char> live::LivePipeline::readFile(const std::string& filePath) {
 void live::LivePipeline::createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo) {
 	
 	assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Can't create graphics pipeline: No pipelineLayout provided in configInfo");
-	assert(configInfo.renderPass != VK_NULL_HANDLE && "Can't create graphics pipeline: No renderPass provided in configInfo");
+	assert((configInfo.renderPass != VK_NULL_HANDLE || !configInfo.colorAttachmentFormats.empty() || configInfo.depthAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+		"Can't create graphics pipeline: No renderPass or attachment formats provided in configInfo");
 
 	auto vertCode = readFile(vertFilePath);
-	auto fragCode = readFile(fragFilePath);
-	
 	createShaderModule(vertCode, &vertShaderModule);
-	createShaderModule(fragCode, &fragShaderModule);
+
+	fragShaderModule = VK_NULL_HANDLE;
+	if (!fragFilePath.empty()) {
+		auto fragCode = readFile(fragFilePath);
+		createShaderModule(fragCode, &fragShaderModule);
+	}
 
 	VkPipelineShaderStageCreateInfo shaderStages[2];
 	shaderStages[0].sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -140,8 +154,8 @@ void live::LivePipeline::createGraphicsPipeline(const std::string& vertFilePath,
 	shaderStages[1].pNext               = nullptr;
 	shaderStages[1].pSpecializationInfo = nullptr;
 
-	auto bindingDescriptions   = Model::Vertex::getBindingDescriptions();
-	auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+	auto& bindingDescriptions   = configInfo.bindingDescriptions;
+	auto& attributeDescriptions = configInfo.attributeDescriptions;
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount   = static_cast<uint32_t>(bindingDescriptions.size());
@@ -151,7 +165,7 @@ void live::LivePipeline::createGraphicsPipeline(const std::string& vertFilePath,
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount          = 2;
+	pipelineInfo.stageCount          = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
 	pipelineInfo.pStages             = shaderStages;
 	pipelineInfo.pVertexInputState   = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -166,10 +180,20 @@ void live::LivePipeline::createGraphicsPipeline(const std::string& vertFilePath,
 	pipelineInfo.renderPass = configInfo.renderPass;
 	pipelineInfo.subpass    = configInfo.subpass;
 
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	if (configInfo.renderPass == VK_NULL_HANDLE) {
+		renderingInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		renderingInfo.colorAttachmentCount    = static_cast<uint32_t>(configInfo.colorAttachmentFormats.size());
+		renderingInfo.pColorAttachmentFormats = configInfo.colorAttachmentFormats.data();
+		renderingInfo.depthAttachmentFormat   = configInfo.depthAttachmentFormat;
+		renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+		pipelineInfo.pNext = &renderingInfo;
+	}
+
 	pipelineInfo.basePipelineIndex  = -1;
 	pipelineInfo.basePipelineHandle = nullptr;
 
-	if (vkCreateGraphicsPipelines(liveDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(liveDevice.device(), configInfo.driverCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create graphics pipeline");
 	}
 }
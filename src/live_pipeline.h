@@ -12,6 +12,8 @@ namespace live {
 		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
 		PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+		std::vector<VkVertexInputBindingDescription>   bindingDescriptions{};
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 		VkPipelineViewportStateCreateInfo      viewportInfo;
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
 		VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -24,11 +26,16 @@ namespace live {
 		VkPipelineLayout                       pipelineLayout = nullptr;
 		VkRenderPass                           renderPass = nullptr;
 		uint32_t                               subpass = 0;
+		// Without a renderPass the pipeline is created for dynamic rendering against these formats
+		std::vector<VkFormat>                  colorAttachmentFormats{};
+		VkFormat                               depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+		VkPipelineCache                        driverCache = VK_NULL_HANDLE;  // optional, shared between creations
 	};
 
 
 	class LivePipeline {
 	public:
+		// An empty fragFilePath creates a pipeline without a fragment stage, for depth-only passes
 		LivePipeline(
 			LiveDevice& device, 
 			const std::string& vertFilePath, 
@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+
+
+namespace live {
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& filepath) {
+		HANDLE file = CreateFileA(
+			filepath.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to query file size: " + filepath);
+		}
+		mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+		// Empty files cannot be mapped
+		if (mappedSize == 0) {
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+		mappingHandle = mapping;
+
+		mappedData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (mappedData == nullptr) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		if (mappedData != nullptr) {
+			UnmapViewOfFile(mappedData);
+		}
+		if (mappingHandle != nullptr) {
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle != nullptr) {
+			CloseHandle(fileHandle);
+		}
+	}
+#else
+	MappedFile::MappedFile(const std::string& filepath) {
+		int file = open(filepath.c_str(), O_RDONLY);
+		if (file < 0) {
+			throw std::runtime_error("Failed to open file: " + filepath);
+		}
+
+		struct stat fileStat{};
+		if (fstat(file, &fileStat) != 0) {
+			close(file);
+			throw std::runtime_error("Failed to query file size: " + filepath);
+		}
+		mappedSize = static_cast<size_t>(fileStat.st_size);
+
+		// Empty files cannot be mapped
+		if (mappedSize == 0) {
+			close(file);
+			return;
+		}
+
+		void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (mapping == MAP_FAILED) {
+			throw std::runtime_error("Failed to map file: " + filepath);
+		}
+
+		madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+		mappedData = static_cast<const char*>(mapping);
+	}
+
+	MappedFile::~MappedFile() {
+		if (mappedData != nullptr) {
+			munmap(const_cast<char*>(mappedData), mappedSize);
+		}
+	}
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+namespace live {
+	// Read-only memory mapping of a whole file. Pages are faulted in on demand and can be dropped by
+	// the OS at any time, so even multi-GB files cost address space rather than memory.
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::string& filepath);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* data() const { return mappedData; }
+		size_t size() const { return mappedSize; }
+
+	private:
+		const char* mappedData = nullptr;
+		size_t      mappedSize = 0;
+
+#ifdef _WIN32
+		void*       fileHandle = nullptr;
+		void*       mappingHandle = nullptr;
+#endif
+	};
+}
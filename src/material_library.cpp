@@ -0,0 +1,23 @@
+#include "material_library.h"
+
+#include <algorithm>
+
+
+namespace live {
+	MaterialLibrary::MaterialLibrary() {
+		materials.push_back({ "default" });
+		textureIndices.push_back(NO_TEXTURE);
+	}
+
+	// Scenes hold tens to a few hundred materials and this only runs at load, so a linear search is enough
+	uint32_t MaterialLibrary::addMaterial(const Material& material) {
+		auto found = std::find(materials.begin(), materials.end(), material);
+		if (found != materials.end()) {
+			return static_cast<uint32_t>(found - materials.begin());
+		}
+
+		materials.push_back(material);
+		textureIndices.push_back(NO_TEXTURE);
+		return static_cast<uint32_t>(materials.size() - 1);
+	}
+}
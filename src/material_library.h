@@ -0,0 +1,50 @@
+#pragma once
+
+#define GLM_DEFINE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+
+namespace live {
+	struct Material {
+		std::string name{};
+		glm::vec3   diffuseColor{ 1.0f };
+		std::string diffuseTexture{};  // file path, empty for none
+
+		bool operator==(const Material& other) const {
+			return name == other.name && diffuseColor == other.diffuseColor && diffuseTexture == other.diffuseTexture;
+		}
+	};
+
+	// Scene-wide material table. Models register their materials here at load time so that identical
+	// materials get one ID across models, which is what draws are sorted and batched by.
+	class MaterialLibrary {
+	public:
+		// Used by geometry without a material
+		static constexpr uint32_t DEFAULT_MATERIAL = 0;
+		// Same value as BindlessDescriptors::INVALID_INDEX
+		static constexpr uint32_t NO_TEXTURE = ~0u;
+
+		MaterialLibrary();
+
+		MaterialLibrary(const MaterialLibrary&) = delete;
+		MaterialLibrary& operator=(const MaterialLibrary&) = delete;
+
+		// Returns the ID of an identical material if one was already added
+		uint32_t addMaterial(const Material& material);
+
+		const Material& getMaterial(uint32_t id) const { return materials[id]; }
+		uint32_t getMaterialCount() const { return static_cast<uint32_t>(materials.size()); }
+
+		// Bindless slot of the material's loaded diffuse texture
+		void setTextureIndex(uint32_t id, uint32_t textureIndex) { textureIndices[id] = textureIndex; }
+		uint32_t getTextureIndex(uint32_t id) const { return textureIndices[id]; }
+
+	private:
+		std::vector<Material> materials{};
+		std::vector<uint32_t> textureIndices{};
+	};
+}
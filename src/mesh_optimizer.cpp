@@ -0,0 +1,809 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+
+namespace live {
+	namespace mesh_optimizer {
+		namespace {
+			constexpr uint32_t INVALID_VERTEX = ~0u;
+
+			// FIFO cache simulation shared by the analysis and the overdraw clustering. A vertex is
+			// resident while fewer than cacheSize misses happened since it was last loaded.
+			class FifoCache {
+			public:
+				FifoCache(size_t vertexCount, uint32_t cacheSize)
+					: timestamps(vertexCount, 0), cacheSize{ cacheSize }, timestamp{ cacheSize + 1 } {}
+
+				bool access(uint32_t vertex) {
+					if (timestamp - timestamps[vertex] > cacheSize) {
+						timestamps[vertex] = timestamp++;
+						return false;
+					}
+					return true;
+				}
+
+			private:
+				std::vector<uint32_t> timestamps;
+				uint32_t              cacheSize;
+				uint32_t              timestamp;
+			};
+
+			const float* vertexPosition(const float* positions, size_t stride, uint32_t vertex) {
+				return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * stride);
+			}
+
+			// Symmetric 4x4 plane quadric, stored as its upper triangle
+			struct Quadric {
+				double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+				double a11 = 0, a12 = 0, a13 = 0;
+				double a22 = 0, a23 = 0;
+				double a33 = 0;
+
+				static Quadric fromPlane(double a, double b, double c, double d) {
+					Quadric q{};
+					q.a00 = a * a; q.a01 = a * b; q.a02 = a * c; q.a03 = a * d;
+					q.a11 = b * b; q.a12 = b * c; q.a13 = b * d;
+					q.a22 = c * c; q.a23 = c * d;
+					q.a33 = d * d;
+					return q;
+				}
+
+				Quadric& operator+=(const Quadric& other) {
+					a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+					a11 += other.a11; a12 += other.a12; a13 += other.a13;
+					a22 += other.a22; a23 += other.a23;
+					a33 += other.a33;
+					return *this;
+				}
+
+				double evaluate(const float* p) const {
+					double x = p[0], y = p[1], z = p[2];
+					double error =
+						a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+						a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+						a22 * z * z + 2 * a23 * z +
+						a33;
+					return error > 0.0 ? error : 0.0;
+				}
+			};
+
+			void triangleNormal(const float* p0, const float* p1, const float* p2, double* normal) {
+				double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+				double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+				normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+				normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+				normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			}
+
+			void computeMeshletBounds(Meshlet& meshlet, const uint32_t* indices, const float* positions, size_t stride) {
+				const uint32_t* triangles = indices + meshlet.firstIndex;
+				size_t          cornerCount = meshlet.triangleCount * 3;
+
+				float minimum[3], maximum[3];
+				for (int i = 0; i < 3; i++) {
+					minimum[i] = maximum[i] = vertexPosition(positions, stride, triangles[0])[i];
+				}
+				for (size_t c = 0; c < cornerCount; c++) {
+					const float* p = vertexPosition(positions, stride, triangles[c]);
+					for (int i = 0; i < 3; i++) {
+						minimum[i] = std::min(minimum[i], p[i]);
+						maximum[i] = std::max(maximum[i], p[i]);
+					}
+				}
+
+				float radiusSquared = 0.0f;
+				for (int i = 0; i < 3; i++) {
+					meshlet.center[i] = (minimum[i] + maximum[i]) * 0.5f;
+				}
+				for (size_t c = 0; c < cornerCount; c++) {
+					const float* p = vertexPosition(positions, stride, triangles[c]);
+					float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+					radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+				}
+				meshlet.radius = std::sqrt(radiusSquared);
+
+				// Cone around the average unit normal; its half angle is the widest normal deviation
+				std::vector<double> normals(meshlet.triangleCount * 3, 0.0);
+				double axis[3] = { 0.0, 0.0, 0.0 };
+				for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+					double* n = &normals[t * 3];
+					triangleNormal(
+						vertexPosition(positions, stride, triangles[t * 3 + 0]),
+						vertexPosition(positions, stride, triangles[t * 3 + 1]),
+						vertexPosition(positions, stride, triangles[t * 3 + 2]),
+						n);
+					double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					if (length > 0.0) {
+						for (int i = 0; i < 3; i++) {
+							n[i] /= length;
+							axis[i] += n[i];
+						}
+					}
+				}
+
+				double axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+				meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+				meshlet.coneCutoff = 1.0f;
+				if (axisLength <= 0.0) {
+					return;
+				}
+
+				double minimumDot = 1.0;
+				for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+					const double* n = &normals[t * 3];
+					if (n[0] == 0.0 && n[1] == 0.0 && n[2] == 0.0) {
+						continue;
+					}
+					minimumDot = std::min(minimumDot, (n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]) / axisLength);
+				}
+
+				for (int i = 0; i < 3; i++) {
+					meshlet.coneAxis[i] = static_cast<float>(axis[i] / axisLength);
+				}
+				if (minimumDot > 0.0) {
+					meshlet.coneCutoff = static_cast<float>(std::sqrt(1.0 - minimumDot * minimumDot));
+				}
+			}
+		}
+
+		VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+			assert(indexCount % 3 == 0 && "Index count must be a multiple of three");
+
+			VertexCacheStats stats{};
+			if (indexCount == 0) {
+				return stats;
+			}
+
+			FifoCache cache{ vertexCount, cacheSize };
+			std::vector<bool> referenced(vertexCount, false);
+			size_t referencedCount = 0;
+
+			for (size_t i = 0; i < indexCount; i++) {
+				uint32_t vertex = indices[i];
+				assert(vertex < vertexCount && "Index out of range");
+
+				if (!cache.access(vertex)) {
+					stats.verticesTransformed += 1;
+				}
+				if (!referenced[vertex]) {
+					referenced[vertex] = true;
+					referencedCount += 1;
+				}
+			}
+
+			stats.acmr = static_cast<float>(stats.verticesTransformed) / static_cast<float>(indexCount / 3);
+			stats.atvr = static_cast<float>(stats.verticesTransformed) / static_cast<float>(referencedCount);
+			return stats;
+		}
+
+		void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+			assert(indexCount % 3 == 0 && "Index count must be a multiple of three");
+			assert(destination != indices && "optimizeVertexCache cannot run in place");
+
+			size_t triangleCount = indexCount / 3;
+
+			// Vertex -> triangle adjacency in CSR form
+			std::vector<uint32_t> liveTriangles(vertexCount, 0);
+			for (size_t i = 0; i < indexCount; i++) {
+				assert(indices[i] < vertexCount && "Index out of range");
+				liveTriangles[indices[i]] += 1;
+			}
+
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (size_t v = 0; v < vertexCount; v++) {
+				adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+			}
+
+			std::vector<uint32_t> adjacency(indexCount);
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t t = 0; t < triangleCount; t++) {
+				for (size_t k = 0; k < 3; k++) {
+					adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+				}
+			}
+
+			std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+			std::vector<bool>     emitted(triangleCount, false);
+			std::vector<uint32_t> deadEnd{};
+			std::vector<uint32_t> candidates{};
+			deadEnd.reserve(indexCount);
+
+			uint32_t timestamp = cacheSize + 1;
+			size_t   cursor = 0;
+			size_t   outputIndex = 0;
+
+			auto nextLiveVertex = [&]() -> uint32_t {
+				// Most recently referenced vertex that still has triangles, then input order
+				while (!deadEnd.empty()) {
+					uint32_t vertex = deadEnd.back();
+					deadEnd.pop_back();
+					if (liveTriangles[vertex] > 0) {
+						return vertex;
+					}
+				}
+				while (cursor < vertexCount) {
+					if (liveTriangles[cursor] > 0) {
+						return static_cast<uint32_t>(cursor);
+					}
+					cursor++;
+				}
+				return INVALID_VERTEX;
+			};
+
+			uint32_t fanningVertex = nextLiveVertex();
+			while (fanningVertex != INVALID_VERTEX) {
+				candidates.clear();
+
+				for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++) {
+					uint32_t triangle = adjacency[a];
+					if (emitted[triangle]) {
+						continue;
+					}
+
+					for (size_t k = 0; k < 3; k++) {
+						uint32_t vertex = indices[triangle * 3 + k];
+						destination[outputIndex++] = vertex;
+						deadEnd.push_back(vertex);
+						candidates.push_back(vertex);
+						liveTriangles[vertex] -= 1;
+
+						if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+							cacheTimestamps[vertex] = timestamp++;
+						}
+					}
+					emitted[triangle] = true;
+				}
+
+				// Prefer the candidate that stays in the cache for all its remaining triangles and
+				// has been resident the longest; ties keep the first candidate so output is stable.
+				uint32_t bestVertex = INVALID_VERTEX;
+				int64_t  bestPriority = -1;
+				for (uint32_t vertex : candidates) {
+					if (liveTriangles[vertex] == 0) {
+						continue;
+					}
+
+					int64_t priority = 0;
+					uint32_t age = timestamp - cacheTimestamps[vertex];
+					if (age + 2 * liveTriangles[vertex] <= cacheSize) {
+						priority = age;
+					}
+
+					if (priority > bestPriority) {
+						bestPriority = priority;
+						bestVertex = vertex;
+					}
+				}
+
+				fanningVertex = bestVertex != INVALID_VERTEX ? bestVertex : nextLiveVertex();
+			}
+
+			assert(outputIndex == indexCount);
+		}
+
+		void optimizeOverdraw(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			const float* vertexPositions,
+			size_t vertexCount,
+			size_t vertexPositionsStride,
+			float threshold,
+			uint32_t cacheSize) {
+			assert(indexCount % 3 == 0 && "Index count must be a multiple of three");
+			assert(destination != indices && "optimizeOverdraw cannot run in place");
+
+			size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0) {
+				return;
+			}
+
+			// A triangle that misses on all three vertices is where the cache optimizer restarted, so
+			// reordering whole clusters between those points keeps most of the cache locality.
+			std::vector<uint32_t> clusterStarts{};
+			FifoCache cache{ vertexCount, cacheSize };
+			for (size_t t = 0; t < triangleCount; t++) {
+				int misses = 0;
+				for (size_t k = 0; k < 3; k++) {
+					misses += cache.access(indices[t * 3 + k]) ? 0 : 1;
+				}
+				if (t == 0 || misses == 3) {
+					clusterStarts.push_back(static_cast<uint32_t>(t));
+				}
+			}
+			size_t clusterCount = clusterStarts.size();
+			clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+			struct ClusterGeometry {
+				float centroid[3]{};
+				float normal[3]{};
+				float area = 0.0f;
+			};
+			std::vector<ClusterGeometry> clusters(clusterCount);
+
+			float meshCentroid[3]{};
+			float meshArea = 0.0f;
+
+			for (size_t c = 0; c < clusterCount; c++) {
+				auto& cluster = clusters[c];
+
+				for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+					const float* p0 = vertexPosition(vertexPositions, vertexPositionsStride, indices[t * 3 + 0]);
+					const float* p1 = vertexPosition(vertexPositions, vertexPositionsStride, indices[t * 3 + 1]);
+					const float* p2 = vertexPosition(vertexPositions, vertexPositionsStride, indices[t * 3 + 2]);
+
+					float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+					float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+					float n[3] = {
+						e1[1] * e2[2] - e1[2] * e2[1],
+						e1[2] * e2[0] - e1[0] * e2[2],
+						e1[0] * e2[1] - e1[1] * e2[0]
+					};
+					float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+					for (int i = 0; i < 3; i++) {
+						float centroid = (p0[i] + p1[i] + p2[i]) / 3.0f;
+						cluster.centroid[i] += centroid * area;
+						cluster.normal[i] += n[i];
+						meshCentroid[i] += centroid * area;
+					}
+					cluster.area += area;
+					meshArea += area;
+				}
+			}
+
+			if (meshArea > 0.0f) {
+				for (int i = 0; i < 3; i++) {
+					meshCentroid[i] /= meshArea;
+				}
+			}
+
+			// Clusters far out along their own normal are the ones most likely to occlude the rest
+			std::vector<float> sortKeys(clusterCount, 0.0f);
+			for (size_t c = 0; c < clusterCount; c++) {
+				auto& cluster = clusters[c];
+				if (cluster.area <= 0.0f) {
+					continue;
+				}
+
+				float normalLength = std::sqrt(
+					cluster.normal[0] * cluster.normal[0] +
+					cluster.normal[1] * cluster.normal[1] +
+					cluster.normal[2] * cluster.normal[2]);
+				if (normalLength <= 0.0f) {
+					continue;
+				}
+
+				float key = 0.0f;
+				for (int i = 0; i < 3; i++) {
+					key += (cluster.centroid[i] / cluster.area - meshCentroid[i]) * (cluster.normal[i] / normalLength);
+				}
+				sortKeys[c] = key;
+			}
+
+			std::vector<uint32_t> clusterOrder(clusterCount);
+			for (size_t c = 0; c < clusterCount; c++) {
+				clusterOrder[c] = static_cast<uint32_t>(c);
+			}
+			std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+				return sortKeys[a] > sortKeys[b];
+			});
+
+			size_t outputIndex = 0;
+			for (uint32_t c : clusterOrder) {
+				size_t first = clusterStarts[c] * 3;
+				size_t count = (clusterStarts[c + 1] - clusterStarts[c]) * 3;
+				std::memcpy(destination + outputIndex, indices + first, count * sizeof(uint32_t));
+				outputIndex += count;
+			}
+
+			float inputAcmr = analyzeVertexCache(indices, indexCount, vertexCount, cacheSize).acmr;
+			float outputAcmr = analyzeVertexCache(destination, indexCount, vertexCount, cacheSize).acmr;
+			if (outputAcmr > inputAcmr * threshold) {
+				std::memcpy(destination, indices, indexCount * sizeof(uint32_t));
+			}
+		}
+
+		size_t simplify(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			const float* vertexPositions,
+			size_t vertexCount,
+			size_t vertexPositionsStride,
+			size_t targetIndexCount,
+			float* resultError) {
+			assert(indexCount % 3 == 0 && "Index count must be a multiple of three");
+			assert(destination != indices && "simplify cannot run in place");
+
+			size_t triangleCount = indexCount / 3;
+			auto position = [&](uint32_t vertex) { return vertexPosition(vertexPositions, vertexPositionsStride, vertex); };
+
+			// Weld vertices by position: attribute seams must not open holes while collapsing. Each
+			// position is represented by its lowest vertex index, which is also what collapsed corners
+			// fall back to in the output.
+			std::vector<uint32_t> sortedVertices(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++) {
+				sortedVertices[v] = static_cast<uint32_t>(v);
+			}
+			std::sort(sortedVertices.begin(), sortedVertices.end(), [&](uint32_t a, uint32_t b) {
+				const float* pa = position(a);
+				const float* pb = position(b);
+				if (pa[0] != pb[0]) return pa[0] < pb[0];
+				if (pa[1] != pb[1]) return pa[1] < pb[1];
+				if (pa[2] != pb[2]) return pa[2] < pb[2];
+				return a < b;
+			});
+
+			std::vector<uint32_t> positionVertex(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++) {
+				uint32_t vertex = sortedVertices[i];
+				bool samePosition = i > 0 && std::memcmp(position(vertex), position(sortedVertices[i - 1]), sizeof(float) * 3) == 0;
+				positionVertex[vertex] = samePosition ? positionVertex[sortedVertices[i - 1]] : vertex;
+			}
+
+			std::vector<uint32_t> corners(indexCount);
+			std::vector<bool>     triangleAlive(triangleCount, false);
+			size_t aliveTriangles = 0;
+			for (size_t t = 0; t < triangleCount; t++) {
+				for (size_t k = 0; k < 3; k++) {
+					assert(indices[t * 3 + k] < vertexCount && "Index out of range");
+					corners[t * 3 + k] = positionVertex[indices[t * 3 + k]];
+				}
+				uint32_t* c = &corners[t * 3];
+				if (c[0] != c[1] && c[1] != c[2] && c[0] != c[2]) {
+					triangleAlive[t] = true;
+					aliveTriangles += 1;
+				}
+			}
+
+			std::vector<Quadric>               quadrics(vertexCount);
+			std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+			std::vector<uint64_t>              edges{};
+			edges.reserve(aliveTriangles * 3);
+
+			for (size_t t = 0; t < triangleCount; t++) {
+				if (!triangleAlive[t]) {
+					continue;
+				}
+
+				const uint32_t* c = &corners[t * 3];
+				double normal[3];
+				triangleNormal(position(c[0]), position(c[1]), position(c[2]), normal);
+				double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				Quadric plane{};
+				if (length > 0.0) {
+					double a = normal[0] / length, b = normal[1] / length, cz = normal[2] / length;
+					const float* p0 = position(c[0]);
+					plane = Quadric::fromPlane(a, b, cz, -(a * p0[0] + b * p0[1] + cz * p0[2]));
+				}
+
+				for (size_t k = 0; k < 3; k++) {
+					quadrics[c[k]] += plane;
+					vertexTriangles[c[k]].push_back(static_cast<uint32_t>(t));
+
+					uint32_t from = c[k];
+					uint32_t to = c[(k + 1) % 3];
+					edges.push_back((static_cast<uint64_t>(std::min(from, to)) << 32) | std::max(from, to));
+				}
+			}
+
+			// Edges used by a single triangle are on an open border; their vertices stay put so the
+			// silhouette of open meshes survives
+			std::vector<bool> locked(vertexCount, false);
+			std::sort(edges.begin(), edges.end());
+			for (size_t i = 0; i < edges.size();) {
+				size_t run = i + 1;
+				while (run < edges.size() && edges[run] == edges[i]) {
+					run++;
+				}
+				if (run - i == 1) {
+					locked[static_cast<uint32_t>(edges[i] >> 32)] = true;
+					locked[static_cast<uint32_t>(edges[i])] = true;
+				}
+				i = run;
+			}
+
+			struct Collapse {
+				double   cost;
+				uint32_t from;
+				uint32_t to;
+				uint32_t fromVersion;
+				uint32_t toVersion;
+			};
+			auto laterCollapse = [](const Collapse& a, const Collapse& b) {
+				if (a.cost != b.cost) return a.cost > b.cost;
+				if (a.from != b.from) return a.from > b.from;
+				return a.to > b.to;
+			};
+
+			std::vector<Collapse> heap{};
+			std::vector<uint32_t> versions(vertexCount, 0);
+			std::vector<bool>     removed(vertexCount, false);
+
+			auto pushCollapse = [&](uint32_t from, uint32_t to) {
+				if (locked[from]) {
+					return;
+				}
+				Quadric combined = quadrics[from];
+				combined += quadrics[to];
+				heap.push_back({ combined.evaluate(position(to)), from, to, versions[from], versions[to] });
+				std::push_heap(heap.begin(), heap.end(), laterCollapse);
+			};
+
+			auto pushVertexEdges = [&](uint32_t vertex) {
+				for (uint32_t t : vertexTriangles[vertex]) {
+					if (!triangleAlive[t]) {
+						continue;
+					}
+					for (size_t k = 0; k < 3; k++) {
+						uint32_t other = corners[t * 3 + k];
+						if (other != vertex) {
+							pushCollapse(vertex, other);
+							pushCollapse(other, vertex);
+						}
+					}
+				}
+			};
+
+			for (size_t t = 0; t < triangleCount; t++) {
+				if (!triangleAlive[t]) {
+					continue;
+				}
+				for (size_t k = 0; k < 3; k++) {
+					pushCollapse(corners[t * 3 + k], corners[t * 3 + (k + 1) % 3]);
+					pushCollapse(corners[t * 3 + (k + 1) % 3], corners[t * 3 + k]);
+				}
+			}
+
+			double maxError = 0.0;
+			while (aliveTriangles * 3 > targetIndexCount && !heap.empty()) {
+				std::pop_heap(heap.begin(), heap.end(), laterCollapse);
+				Collapse collapse = heap.back();
+				heap.pop_back();
+
+				uint32_t from = collapse.from;
+				uint32_t to = collapse.to;
+				if (removed[from] || removed[to] || versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion) {
+					continue;
+				}
+
+				// Reject collapses that would flip a surviving triangle
+				bool flips = false;
+				for (uint32_t t : vertexTriangles[from]) {
+					const uint32_t* c = &corners[t * 3];
+					if (!triangleAlive[t] || c[0] == to || c[1] == to || c[2] == to) {
+						continue;
+					}
+
+					const float* before[3] = { position(c[0]), position(c[1]), position(c[2]) };
+					const float* after[3] = { before[0], before[1], before[2] };
+					for (size_t k = 0; k < 3; k++) {
+						if (c[k] == from) {
+							after[k] = position(to);
+						}
+					}
+
+					double normalBefore[3], normalAfter[3];
+					triangleNormal(before[0], before[1], before[2], normalBefore);
+					triangleNormal(after[0], after[1], after[2], normalAfter);
+					if (normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0) {
+						flips = true;
+						break;
+					}
+				}
+				if (flips) {
+					continue;
+				}
+
+				for (uint32_t t : vertexTriangles[from]) {
+					if (!triangleAlive[t]) {
+						continue;
+					}
+
+					uint32_t* c = &corners[t * 3];
+					if (c[0] == to || c[1] == to || c[2] == to) {
+						triangleAlive[t] = false;
+						aliveTriangles -= 1;
+						continue;
+					}
+
+					for (size_t k = 0; k < 3; k++) {
+						if (c[k] == from) {
+							c[k] = to;
+						}
+					}
+					vertexTriangles[to].push_back(t);
+				}
+
+				quadrics[to] += quadrics[from];
+				removed[from] = true;
+				versions[to] += 1;
+				maxError = std::max(maxError, collapse.cost);
+
+				pushVertexEdges(to);
+			}
+
+			// Corners that kept their position keep their original vertex and attributes
+			size_t outputIndex = 0;
+			for (size_t t = 0; t < triangleCount; t++) {
+				if (!triangleAlive[t]) {
+					continue;
+				}
+				for (size_t k = 0; k < 3; k++) {
+					uint32_t original = indices[t * 3 + k];
+					uint32_t corner = corners[t * 3 + k];
+					destination[outputIndex++] = positionVertex[original] == corner ? original : corner;
+				}
+			}
+
+			if (resultError != nullptr) {
+				*resultError = static_cast<float>(std::sqrt(maxError));
+			}
+
+			return outputIndex;
+		}
+
+		std::vector<Meshlet> buildMeshlets(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			const float* vertexPositions,
+			size_t vertexCount,
+			size_t vertexPositionsStride,
+			size_t maxVertices,
+			size_t maxTriangles) {
+			assert(indexCount % 3 == 0 && "Index count must be a multiple of three");
+			assert(destination != indices && "buildMeshlets cannot run in place");
+			assert(maxVertices >= 3 && maxTriangles >= 1);
+
+			size_t triangleCount = indexCount / 3;
+			std::vector<Meshlet> meshlets{};
+
+			// Vertex -> triangle adjacency in CSR form
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (size_t i = 0; i < indexCount; i++) {
+				assert(indices[i] < vertexCount && "Index out of range");
+				adjacencyOffsets[indices[i] + 1] += 1;
+			}
+			for (size_t v = 0; v < vertexCount; v++) {
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			}
+			std::vector<uint32_t> adjacency(indexCount);
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t t = 0; t < triangleCount; t++) {
+				for (size_t k = 0; k < 3; k++) {
+					adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+				}
+			}
+
+			std::vector<bool>     emitted(triangleCount, false);
+			std::vector<uint32_t> vertexMeshlet(vertexCount, INVALID_VERTEX);
+			std::vector<uint32_t> meshletVertices{};
+			meshletVertices.reserve(maxVertices);
+
+			Meshlet current{};
+			size_t  outputIndex = 0;
+			size_t  seedCursor = 0;
+
+			auto newVertexCount = [&](size_t triangle) {
+				const uint32_t* c = &indices[triangle * 3];
+				uint32_t id = static_cast<uint32_t>(meshlets.size());
+				size_t count = 0;
+				for (size_t k = 0; k < 3; k++) {
+					bool repeated = (k > 0 && c[k] == c[0]) || (k > 1 && c[k] == c[1]);
+					if (!repeated && vertexMeshlet[c[k]] != id) {
+						count++;
+					}
+				}
+				return count;
+			};
+
+			auto closeMeshlet = [&]() {
+				computeMeshletBounds(current, destination, vertexPositions, vertexPositionsStride);
+				meshlets.push_back(current);
+				current = Meshlet{};
+				current.firstIndex = static_cast<uint32_t>(outputIndex);
+				meshletVertices.clear();
+			};
+
+			for (size_t emittedCount = 0; emittedCount < triangleCount;) {
+				size_t best = triangleCount;
+				size_t bestCost = 4;
+				for (uint32_t vertex : meshletVertices) {
+					for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++) {
+						uint32_t triangle = adjacency[a];
+						if (emitted[triangle]) {
+							continue;
+						}
+						size_t cost = newVertexCount(triangle);
+						if (cost < bestCost || (cost == bestCost && triangle < best)) {
+							best = triangle;
+							bestCost = cost;
+						}
+					}
+				}
+
+				if (best == triangleCount) {
+					bool halfFull = current.triangleCount * 2 >= maxTriangles || meshletVertices.size() * 2 >= maxVertices;
+					if (current.triangleCount > 0 && halfFull) {
+						closeMeshlet();
+						continue;
+					}
+
+					while (emitted[seedCursor]) {
+						seedCursor++;
+					}
+					best = seedCursor;
+					bestCost = newVertexCount(best);
+				}
+
+				if (meshletVertices.size() + bestCost > maxVertices || current.triangleCount + 1 > maxTriangles) {
+					closeMeshlet();
+					continue;
+				}
+
+				uint32_t id = static_cast<uint32_t>(meshlets.size());
+				for (size_t k = 0; k < 3; k++) {
+					uint32_t vertex = indices[best * 3 + k];
+					destination[outputIndex++] = vertex;
+					if (vertexMeshlet[vertex] != id) {
+						vertexMeshlet[vertex] = id;
+						meshletVertices.push_back(vertex);
+					}
+				}
+				emitted[best] = true;
+				emittedCount++;
+				current.triangleCount += 1;
+				current.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+			}
+
+			if (current.triangleCount > 0) {
+				closeMeshlet();
+			}
+
+			return meshlets;
+		}
+
+		size_t optimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+			std::fill(remap, remap + vertexCount, INVALID_VERTEX);
+
+			uint32_t nextVertex = 0;
+			for (size_t i = 0; i < indexCount; i++) {
+				uint32_t vertex = indices[i];
+				assert(vertex < vertexCount && "Index out of range");
+
+				if (remap[vertex] == INVALID_VERTEX) {
+					remap[vertex] = nextVertex++;
+				}
+			}
+
+			return nextVertex;
+		}
+
+		void remapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t indexCount, const uint32_t* remap) {
+			for (size_t i = 0; i < indexCount; i++) {
+				assert(remap[indices[i]] != INVALID_VERTEX);
+				destination[i] = remap[indices[i]];
+			}
+		}
+
+		void remapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap) {
+			assert(destination != vertices && "remapVertexBuffer cannot run in place");
+
+			char*       output = static_cast<char*>(destination);
+			const char* input = static_cast<const char*>(vertices);
+			for (size_t v = 0; v < vertexCount; v++) {
+				if (remap[v] != INVALID_VERTEX) {
+					std::memcpy(output + remap[v] * vertexSize, input + v * vertexSize, vertexSize);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace live {
+	// Load-time index/vertex reordering. Everything here works on raw arrays, has no Vulkan or
+	// allocation-order dependencies and is deterministic, so it can be run and timed on its own.
+	//
+	// The usual order is optimizeVertexCache -> optimizeOverdraw -> optimizeVertexFetchRemap.
+	namespace mesh_optimizer {
+		// Post-transform cache size assumed by the optimizer and the analysis; 16 entries is a good
+		// middle ground across current GPUs.
+		constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+		struct VertexCacheStats {
+			uint32_t verticesTransformed = 0;
+			float    acmr = 0.0f;  // transformed vertices per triangle, 0.5 is the limit for large grids
+			float    atvr = 0.0f;  // transformed vertices per referenced vertex, 1.0 is optimal
+		};
+
+		// Simulates a FIFO post-transform cache over the index stream.
+		VertexCacheStats analyzeVertexCache(
+			const uint32_t* indices,
+			size_t indexCount,
+			size_t vertexCount,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+		// Reorders triangles for post-transform cache reuse (Tipsify, Sander et al. 2007).
+		// destination must not alias indices.
+		void optimizeVertexCache(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			size_t vertexCount,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+		// Splits a cache-optimized index buffer into clusters at cache restarts and orders the clusters
+		// so outward facing ones are drawn first. If that costs more than `threshold` times the input
+		// ACMR the input order is kept. destination must not alias indices.
+		void optimizeOverdraw(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			const float* vertexPositions,
+			size_t vertexCount,
+			size_t vertexPositionsStride,
+			float threshold = 1.05f,
+			uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+		// Quadric error metric edge collapse (Garland & Heckbert 1997) down to at most targetIndexCount
+		// indices. Only the index buffer changes: every collapse moves a vertex onto an existing
+		// neighbour, so the result indexes the same vertex buffer. Vertices that share a position are
+		// welded for the topology, and vertices on open borders are never moved. resultError receives
+		// the accumulated quadric error as a distance in model units. Returns the new index count.
+		// destination must not alias indices.
+		size_t simplify(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			const float* vertexPositions,
+			size_t vertexCount,
+			size_t vertexPositionsStride,
+			size_t targetIndexCount,
+			float* resultError = nullptr);
+
+		// Meshlet limits matching common mesh shader guidance, also a good granularity for CPU culling
+		constexpr size_t MAX_MESHLET_VERTICES = 64;
+		constexpr size_t MAX_MESHLET_TRIANGLES = 124;
+
+		// Run of triangles in a meshlet-ordered index buffer with its culling bounds. The cone is
+		// built from the triangles' winding normals: every triangle faces away from a viewer at
+		// position p when dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius.
+		// coneCutoff is 1 when the normals spread too far for that test to ever pass.
+		struct Meshlet {
+			uint32_t firstIndex;
+			uint32_t triangleCount;
+			uint32_t vertexCount;
+			float    center[3];
+			float    radius;
+			float    coneAxis[3];
+			float    coneCutoff;
+		};
+
+		// Greedily grows each meshlet through triangles adjacent to it, preferring the triangle that
+		// adds the fewest new vertices, and writes the triangles to destination meshlet by meshlet.
+		// A meshlet that is at least half full is closed once nothing adjacent is left, so meshlets
+		// stay spatially compact. Keeps the input order where it can, so run it after
+		// optimizeVertexCache. destination must not alias indices.
+		std::vector<Meshlet> buildMeshlets(
+			uint32_t* destination,
+			const uint32_t* indices,
+			size_t indexCount,
+			const float* vertexPositions,
+			size_t vertexCount,
+			size_t vertexPositionsStride,
+			size_t maxVertices = MAX_MESHLET_VERTICES,
+			size_t maxTriangles = MAX_MESHLET_TRIANGLES);
+
+		// Builds a remap table that orders vertices by first use in the index buffer. Unreferenced
+		// vertices map to ~0u. Returns the number of vertices left after remapping.
+		size_t optimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+		// destination may alias indices.
+		void remapIndexBuffer(uint32_t* destination, const uint32_t* indices, size_t indexCount, const uint32_t* remap);
+
+		// destination must hold the count returned by optimizeVertexFetchRemap and must not alias vertices.
+		void remapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const uint32_t* remap);
+	}
+}
@@ -1,13 +1,18 @@
 #include "model.h"
+#include "obj_parser.h"
 #include "utility.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 #define GLM_EXPERIMENTAL_ENABLE
 #include <glm/gtx/hash.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <iostream>
 #include <unordered_map>
 
 
@@ -23,17 +28,179 @@ namespace std {
 }
 
 
-live::Model::Model(LiveDevice& device, const Model::Builder& builder) : liveDevice{ device } {
-	createVertexBuffers(builder.vertices);
-	createIndexBuffers(builder.indices);
+namespace {
+	// Turns streamed OBJ triangles into deduplicated builder vertices. Corners are deduplicated by
+	// their OBJ index triple in an open addressing table, which costs a fraction of the vertex itself.
+	// The material of every triangle is recorded as an index into Builder::materials, where 0 is the
+	// default and parser material i is i + 1.
+	class BuilderObjSink : public live::ObjParser::Sink {
+	public:
+		BuilderObjSink(std::vector<live::Model::Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<uint32_t>& triangleMaterials)
+			: vertices{ vertices }, indices{ indices }, triangleMaterials{ triangleMaterials }, slots(1024) {}
+
+		void onTriangle(const live::ObjParser::Attributes& attributes, const live::ObjParser::Index (&corners)[3]) override {
+			for (const auto& corner : corners) {
+				indices.push_back(findOrAddVertex(attributes, corner));
+			}
+			triangleMaterials.push_back(material);
+		}
+
+		void onMaterial(uint32_t parserMaterial) override {
+			material = parserMaterial == live::ObjParser::NO_MATERIAL ? 0 : parserMaterial + 1;
+		}
+
+	private:
+		static constexpr uint32_t EMPTY_SLOT = ~0u;
+
+		struct Slot {
+			live::ObjParser::Index key{};
+			uint32_t               vertex = EMPTY_SLOT;
+		};
+
+		static size_t hashIndex(const live::ObjParser::Index& index) {
+			uint64_t hash = static_cast<uint32_t>(index.position);
+			hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(index.texcoord);
+			hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(index.normal);
+			return static_cast<size_t>(hash ^ (hash >> 29));
+		}
+
+		size_t findSlot(const live::ObjParser::Index& key) const {
+			size_t mask = slots.size() - 1;
+			size_t slot = hashIndex(key) & mask;
+			while (slots[slot].vertex != EMPTY_SLOT && !(slots[slot].key == key)) {
+				slot = (slot + 1) & mask;
+			}
+			return slot;
+		}
+
+		void grow() {
+			std::vector<Slot> oldSlots(slots.size() * 2);
+			oldSlots.swap(slots);
+			for (const auto& slot : oldSlots) {
+				if (slot.vertex != EMPTY_SLOT) {
+					slots[findSlot(slot.key)] = slot;
+				}
+			}
+		}
+
+		uint32_t findOrAddVertex(const live::ObjParser::Attributes& attributes, const live::ObjParser::Index& corner) {
+			size_t slot = findSlot(corner);
+			if (slots[slot].vertex != EMPTY_SLOT) {
+				return slots[slot].vertex;
+			}
+
+			live::Model::Vertex vertex{};
+			const float* position = &attributes.positions[3 * corner.position];
+			vertex.position = { position[0], position[1], position[2] };
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+			if (!attributes.colors.empty()) {
+				const float* color = &attributes.colors[3 * corner.position];
+				vertex.color = { color[0], color[1], color[2] };
+			}
+			if (corner.normal >= 0) {
+				const float* normal = &attributes.normals[3 * corner.normal];
+				vertex.normal = { normal[0], normal[1], normal[2] };
+			}
+			if (corner.texcoord >= 0) {
+				const float* texcoord = &attributes.texcoords[2 * corner.texcoord];
+				vertex.uv = { texcoord[0], texcoord[1] };
+			}
+
+			uint32_t vertexIndex = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(vertex);
+			slots[slot] = { corner, vertexIndex };
+
+			// Keep the load factor under 3/4
+			if (++slotsUsed * 4 > slots.size() * 3) {
+				grow();
+			}
+			return vertexIndex;
+		}
+
+		std::vector<live::Model::Vertex>& vertices;
+		std::vector<uint32_t>&            indices;
+		std::vector<uint32_t>&            triangleMaterials;
+		uint32_t                          material = 0;
+		std::vector<Slot>                 slots;
+		size_t                            slotsUsed = 0;
+	};
+
+	std::string directoryOf(const std::string& filepath) {
+		size_t separator = filepath.find_last_of("/\\");
+		return separator == std::string::npos ? std::string{} : filepath.substr(0, separator + 1);
+	}
+
+	// Octahedral mapping of a unit vector onto [-1, 1]^2, see octahedralDecode in the packed shaders
+	glm::vec2 octahedralEncode(glm::vec3 n) {
+		float l1Norm = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (l1Norm == 0.0f) {
+			return glm::vec2{ 0.0f };
+		}
+
+		n /= l1Norm;
+		glm::vec2 encoded{ n.x, n.y };
+		if (n.z < 0.0f) {
+			glm::vec2 signs{ encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f };
+			encoded = (1.0f - glm::abs(glm::vec2{ n.y, n.x })) * signs;
+		}
+		return encoded;
+	}
+
+	// Largest axis scale of a model matrix, which bounds how much it stretches lengths
+	float maxAxisScale(const glm::mat4& modelMatrix) {
+		return glm::max(
+			glm::length(glm::vec3{ modelMatrix[0] }),
+			glm::max(glm::length(glm::vec3{ modelMatrix[1] }), glm::length(glm::vec3{ modelMatrix[2] })));
+	}
+}
+
+
+live::Model::Model(LiveDevice& device, const Model::Builder& builder, VertexFormat vertexFormat, MaterialLibrary* materialLibrary)
+	: liveDevice{ device }, vertexFormat{ vertexFormat } {
+	if (vertexFormat == VertexFormat::Packed) {
+		createPackedVertexBuffers(builder.vertices);
+	} else {
+		createVertexBuffers(builder.vertices);
+	}
+	computeBoundingSphere(builder.vertices);
+
+	std::vector<uint32_t> materialIds{ MaterialLibrary::DEFAULT_MATERIAL };
+	if (!builder.materials.empty()) {
+		materialIds.resize(builder.materials.size());
+		for (uint32_t i = 0; i < builder.materials.size(); i++) {
+			materialIds[i] = materialLibrary != nullptr ? materialLibrary->addMaterial(builder.materials[i]) : i;
+		}
+	}
+	createIndexBuffers(builder, materialIds);
 }
 
 live::Model::~Model() {}
 
-std::unique_ptr<live::Model> live::Model::createModelFromFile(LiveDevice& device, const std::string& filepath) {
+std::unique_ptr<live::Model> live::Model::createModelFromFile(
+	LiveDevice& device,
+	const std::string& filepath,
+	const ModelLoadOptions& options,
+	MaterialLibrary* materialLibrary,
+	OptimizationReport* report) {
 	Builder builder{};
-	builder.loadModels(filepath);
-	return std::make_unique<Model>(device, builder);
+	builder.loadModels(filepath, options.loadThreads);
+
+	if (options.optimize) {
+		OptimizationReport optimization = builder.optimize();
+		if (report != nullptr) {
+			*report = optimization;
+		}
+	}
+
+	if (!options.lodRatios.empty()) {
+		builder.generateLods(options.lodRatios);
+	}
+
+	if (options.buildMeshlets) {
+		builder.buildMeshlets();
+	}
+
+	return std::make_unique<Model>(device, builder, options.vertexFormat, materialLibrary);
 }
 
 void live::Model::bind(VkCommandBuffer commandBuffer) {
@@ -42,23 +209,183 @@ void live::Model::bind(VkCommandBuffer commandBuffer) {
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
 	if (hasIndexBuffer) {
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+	}
+}
+
+void live::Model::bindPositions(VkCommandBuffer commandBuffer) {
+	VkBuffer buffers[] = { positionBuffer->getBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+	if (hasIndexBuffer) {
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
 	}
 }
 
-void live::Model::draw(VkCommandBuffer commandBuffer) {
+void live::Model::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance, uint32_t lod) {
 	if (hasIndexBuffer) {
-		vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+		assert(lod < lods.size() && "LOD out of range");
+		for (uint32_t i = 0; i < lods[lod].rangeCount; i++) {
+			const auto& range = indexRanges[lods[lod].firstRange + i];
+			vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, range.vertexOffset, firstInstance);
+		}
+	} else {
+		vkCmdDraw(commandBuffer, vertexCount, 1, 0, firstInstance);
+	}
+}
+
+void live::Model::drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submesh, uint32_t firstInstance, uint32_t lod) {
+	if (hasIndexBuffer) {
+		assert(lod < lods.size() && submesh < submeshCount && "Submesh out of range");
+		const Submesh& drawn = getSubmesh(submesh, lod);
+		for (uint32_t i = 0; i < drawn.rangeCount; i++) {
+			const auto& range = indexRanges[drawn.firstRange + i];
+			vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, range.vertexOffset, firstInstance);
+		}
+	} else {
+		vkCmdDraw(commandBuffer, vertexCount, 1, 0, firstInstance);
+	}
+}
+
+VkDrawIndexedIndirectCommand live::Model::getMeshletDrawCommand(uint32_t meshlet, uint32_t firstInstance) const {
+	VkDrawIndexedIndirectCommand command{};
+	command.indexCount    = meshlets[meshlet].triangleCount * 3;
+	command.instanceCount = 1;
+	command.firstIndex    = meshlets[meshlet].firstIndex;
+	command.vertexOffset  = meshletVertexOffsets[meshlet];
+	command.firstInstance = firstInstance;
+	return command;
+}
+
+void live::Model::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount) {
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (liveDevice.enabledFeatures.multiDrawIndirect) {
+		uint32_t maxDrawCount = liveDevice.properties.limits.maxDrawIndirectCount;
+		for (uint32_t first = 0; first < drawCount; first += maxDrawCount) {
+			uint32_t count = std::min(maxDrawCount, drawCount - first);
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + static_cast<VkDeviceSize>(first) * stride, count, stride);
+		}
 	} else {
-	vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+		for (uint32_t i = 0; i < drawCount; i++) {
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + static_cast<VkDeviceSize>(i) * stride, 1, stride);
+		}
+	}
+}
+
+float live::Model::getNearestViewDepth(const Camera& camera, const glm::mat4& modelMatrix) const {
+	float scale = maxAxisScale(modelMatrix);
+
+	glm::vec3 center = glm::vec3{ modelMatrix * glm::vec4{ boundingCenter, 1.0f } };
+	return camera.getViewDepth(center) - boundingRadius * scale;
+}
+
+uint32_t live::Model::selectLod(const Camera& camera, const glm::mat4& modelMatrix, float errorThreshold) const {
+	if (lods.size() <= 1) {
+		return 0;
+	}
+
+	float scale = maxAxisScale(modelMatrix);
+
+	// Measure at the nearest point of the bounding sphere so large objects don't coarsen up close
+	float depth = getNearestViewDepth(camera, modelMatrix);
+
+	uint32_t selected = 0;
+	for (uint32_t lod = 1; lod < lods.size(); lod++) {
+		if (camera.getProjectedHeight(lods[lod].error * scale, depth) > errorThreshold) {
+			break;
+		}
+		selected = lod;
+	}
+	return selected;
+}
+
+glm::mat4 live::Model::getDequantizationMatrix() const {
+	glm::mat4 dequantization{ 1.0f };
+	dequantization[0][0] = boundsScale.x;
+	dequantization[1][1] = boundsScale.y;
+	dequantization[2][2] = boundsScale.z;
+	dequantization[3]    = glm::vec4{ boundsMin, 1.0f };
+	return dequantization;
+}
+
+void live::Model::computeBoundingSphere(const std::vector<Vertex>& vertices) {
+	if (vertices.empty()) {
+		return;
+	}
+
+	glm::vec3 minimum = vertices[0].position;
+	glm::vec3 maximum = vertices[0].position;
+	for (const auto& vertex : vertices) {
+		minimum = glm::min(minimum, vertex.position);
+		maximum = glm::max(maximum, vertex.position);
+	}
+
+	boundingCenter = (minimum + maximum) * 0.5f;
+	boundingRadius = 0.0f;
+	for (const auto& vertex : vertices) {
+		boundingRadius = glm::max(boundingRadius, glm::length(vertex.position - boundingCenter));
 	}
 }
 
 void live::Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
-	vertexCount = static_cast<uint32_t>(vertices.size());
+	uploadVertexBuffer(vertexBuffer, vertices.data(), sizeof(Vertex), static_cast<uint32_t>(vertices.size()));
+
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		positions[i] = vertices[i].position;
+	}
+	uploadVertexBuffer(positionBuffer, positions.data(), sizeof(glm::vec3), static_cast<uint32_t>(positions.size()));
+}
+
+void live::Model::createPackedVertexBuffers(const std::vector<Vertex>& vertices) {
+	assert(!vertices.empty() && "Cannot pack an empty vertex buffer");
+
+	glm::vec3 boundsMax = vertices[0].position;
+	boundsMin = vertices[0].position;
+	for (const auto& vertex : vertices) {
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+
+	// A flat axis still needs an invertible scale for the normal matrix
+	glm::vec3 extent = boundsMax - boundsMin;
+	for (int axis = 0; axis < 3; axis++) {
+		boundsScale[axis] = extent[axis] > 0.0f ? extent[axis] : 1.0f;
+	}
+
+	std::vector<PackedVertex> packedVertices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Vertex& vertex = vertices[i];
+		PackedVertex& packed = packedVertices[i];
+
+		glm::vec3 position = glm::clamp((vertex.position - boundsMin) / boundsScale, 0.0f, 1.0f);
+		uint64_t  packedPosition = glm::packUnorm4x16(glm::vec4{ position, 0.0f });
+		std::memcpy(packed.position, &packedPosition, sizeof(packed.position));
+
+		// Stored in the quantized space so that (model * dequantization) transforms it correctly
+		uint32_t packedNormal = glm::packSnorm2x16(octahedralEncode(vertex.normal * boundsScale));
+		std::memcpy(packed.normal, &packedNormal, sizeof(packed.normal));
+
+		packed.color = glm::packUnorm4x8(glm::vec4{ glm::clamp(vertex.color, 0.0f, 1.0f), 1.0f });
+		packed.uv    = glm::packHalf2x16(vertex.uv);
+	}
+
+	uploadVertexBuffer(vertexBuffer, packedVertices.data(), sizeof(PackedVertex), static_cast<uint32_t>(packedVertices.size()));
+
+	// The same bits as PackedVertex::position, so depth matches the full vertex stream exactly
+	std::vector<uint64_t> positions(packedVertices.size());
+	for (size_t i = 0; i < packedVertices.size(); i++) {
+		std::memcpy(&positions[i], packedVertices[i].position, sizeof(packedVertices[i].position));
+	}
+	uploadVertexBuffer(positionBuffer, positions.data(), sizeof(uint64_t), static_cast<uint32_t>(positions.size()));
+}
+
+void live::Model::uploadVertexBuffer(std::unique_ptr<Buffer>& target, const void* vertexData, uint32_t vertexSize, uint32_t count) {
+	vertexCount = count;
 	assert(vertexCount >= 3 && "Vertex count must be three or greater");
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-	uint32_t vertexSize = sizeof(vertices[0]);
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexSize) * vertexCount;
 
 	Buffer stagingBuffer{
 		liveDevice,
@@ -69,9 +396,9 @@ void live::Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
 	};
 
 	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)vertices.data());
+	stagingBuffer.writeToBuffer((void*)vertexData);
 
-	vertexBuffer = std::make_unique<Buffer>(
+	target = std::make_unique<Buffer>(
 		liveDevice,
 		vertexSize,
 		vertexCount,
@@ -79,19 +406,103 @@ void live::Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
 
-	liveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+	liveDevice.copyBuffer(stagingBuffer.getBuffer(), target->getBuffer(), bufferSize);
 }
 
-void live::Model::createIndexBuffers(const std::vector<uint32_t>& indices) {
+void live::Model::createIndexBuffers(const Model::Builder& builder, const std::vector<uint32_t>& materialIds) {
+	const auto& indices = builder.indices;
 	indexCount = static_cast<uint32_t>(indices.size());
 	hasIndexBuffer = indexCount > 0;
 
 	if (!hasIndexBuffer) {
+		submeshes.push_back({ 0, 0, materialIds[0], 0, 0 });
 		return;
 	}
 
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-	uint32_t     indexSize = sizeof(indices[0]);
+	std::vector<LodLevel> levels = builder.lods;
+	if (levels.empty()) {
+		levels.push_back({ 0, indexCount, 0.0f });
+	}
+
+	std::vector<SubmeshRange> submeshRanges = builder.submeshes;
+	if (submeshRanges.empty()) {
+		for (const auto& level : levels) {
+			submeshRanges.push_back({ level.firstIndex, level.indexCount, 0 });
+		}
+		submeshRanges[0].meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+	}
+	submeshCount = static_cast<uint32_t>(submeshRanges.size() / levels.size());
+	assert(submeshCount * levels.size() == submeshRanges.size() && "Every LOD needs the same submeshes");
+
+	// Meshlets of LOD 0 are drawn on their own, so ranges may only be cut between them
+	auto meshletEnds = [&builder](const SubmeshRange& submesh) {
+		std::vector<uint32_t> ends{};
+		for (uint32_t i = submesh.firstMeshlet; i < submesh.firstMeshlet + submesh.meshletCount; i++) {
+			ends.push_back(builder.meshlets[i].firstIndex + builder.meshlets[i].triangleCount * 3);
+		}
+		return ends;
+	};
+
+	// Every submesh of every LOD must fit 16-bit indices for the buffer to use them
+	indexType = VK_INDEX_TYPE_UINT16;
+	for (size_t level = 0; level < levels.size() && indexType == VK_INDEX_TYPE_UINT16; level++) {
+		lods.push_back({ static_cast<uint32_t>(indexRanges.size()), 0, levels[level].error });
+		for (uint32_t i = 0; i < submeshCount; i++) {
+			const SubmeshRange& range = submeshRanges[level * submeshCount + i];
+			std::vector<uint32_t> unitEnds = level == 0 ? meshletEnds(range) : std::vector<uint32_t>{};
+
+			submeshes.push_back({ static_cast<uint32_t>(indexRanges.size()), 0, materialIds[range.material], range.firstMeshlet, range.meshletCount });
+			if (!splitIndexRanges16(indices, { range.firstIndex, range.indexCount, 0.0f }, unitEnds, indexRanges)) {
+				indexType = VK_INDEX_TYPE_UINT32;
+				break;
+			}
+			submeshes.back().rangeCount = static_cast<uint32_t>(indexRanges.size()) - submeshes.back().firstRange;
+		}
+		lods.back().rangeCount = static_cast<uint32_t>(indexRanges.size()) - lods.back().firstRange;
+	}
+
+	if (indexType == VK_INDEX_TYPE_UINT32) {
+		lods.clear();
+		submeshes.clear();
+		indexRanges.clear();
+		for (size_t level = 0; level < levels.size(); level++) {
+			lods.push_back({ static_cast<uint32_t>(indexRanges.size()), submeshCount, levels[level].error });
+			for (uint32_t i = 0; i < submeshCount; i++) {
+				const SubmeshRange& range = submeshRanges[level * submeshCount + i];
+				submeshes.push_back({ static_cast<uint32_t>(indexRanges.size()), 1, materialIds[range.material], range.firstMeshlet, range.meshletCount });
+				indexRanges.push_back({ range.firstIndex, range.indexCount, 0 });
+			}
+		}
+	}
+
+	meshlets = builder.meshlets;
+	meshletVertexOffsets.assign(meshlets.size(), 0);
+	for (size_t i = 0; i < meshlets.size(); i++) {
+		for (uint32_t r = 0; r < lods[0].rangeCount; r++) {
+			const auto& range = indexRanges[lods[0].firstRange + r];
+			if (meshlets[i].firstIndex >= range.firstIndex && meshlets[i].firstIndex < range.firstIndex + range.indexCount) {
+				meshletVertexOffsets[i] = range.vertexOffset;
+				break;
+			}
+		}
+	}
+
+	std::vector<uint16_t> shortIndices{};
+	const void*           indexData = indices.data();
+	uint32_t              indexSize = sizeof(uint32_t);
+
+	if (indexType == VK_INDEX_TYPE_UINT16) {
+		shortIndices.resize(indexCount);
+		for (const auto& range : indexRanges) {
+			for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+				shortIndices[i] = static_cast<uint16_t>(indices[i] - static_cast<uint32_t>(range.vertexOffset));
+			}
+		}
+		indexData = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+	}
+
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * indexCount;
 	
 	Buffer stagingBuffer{
 		liveDevice,
@@ -102,7 +513,7 @@ void live::Model::createIndexBuffers(const std::vector<uint32_t>& indices) {
 	};
 
 	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)indices.data());
+	stagingBuffer.writeToBuffer((void*)indexData);
 
 	indexBuffer = std::make_unique<Buffer>(
 		liveDevice,
@@ -115,6 +526,66 @@ void live::Model::createIndexBuffers(const std::vector<uint32_t>& indices) {
 	liveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
 }
 
+// Cuts one LOD's triangle list into runs whose vertices span fewer than 65536 consecutive vertices,
+// each drawn with its own vertexOffset. Runs are only cut at unit ends: after every triangle, or
+// after the given index offsets when the level is drawn in larger pieces. Loading and
+// Builder::optimize both number vertices in first-use order, so consecutive triangles cover compact
+// vertex windows and large meshes usually need only a handful of ranges; if a mesh would need too
+// many draws for that, it stays 32-bit.
+bool live::Model::splitIndexRanges16(
+	const std::vector<uint32_t>& indices,
+	const LodLevel& level,
+	const std::vector<uint32_t>& unitEnds,
+	std::vector<IndexRange>& ranges) {
+	static constexpr uint32_t MAX_SHORT_VERTEX_SPAN = 65536;
+	static constexpr uint32_t MIN_INDICES_PER_RANGE = 3 * 4096;
+
+	if (level.indexCount == 0) {
+		return true;
+	}
+
+	size_t   firstNewRange = ranges.size();
+	uint32_t levelEnd = level.firstIndex + level.indexCount;
+	uint32_t rangeStart = level.firstIndex;
+	uint32_t rangeMin = ~0u;
+	uint32_t rangeMax = 0;
+	size_t   nextUnit = 0;
+
+	for (uint32_t index = level.firstIndex; index < levelEnd;) {
+		uint32_t unitEnd = nextUnit < unitEnds.size() ? unitEnds[nextUnit++] : index + 3;
+		assert(unitEnd > index && unitEnd <= levelEnd);
+
+		uint32_t unitMin = ~0u;
+		uint32_t unitMax = 0;
+		for (uint32_t i = index; i < unitEnd; i++) {
+			unitMin = std::min(unitMin, indices[i]);
+			unitMax = std::max(unitMax, indices[i]);
+		}
+		if (unitMax - unitMin >= MAX_SHORT_VERTEX_SPAN) {
+			return false;
+		}
+
+		uint32_t newMin = std::min(rangeMin, unitMin);
+		uint32_t newMax = std::max(rangeMax, unitMax);
+		if (newMax - newMin >= MAX_SHORT_VERTEX_SPAN) {
+			ranges.push_back({ rangeStart, index - rangeStart, static_cast<int32_t>(rangeMin) });
+			rangeStart = index;
+			newMin = unitMin;
+			newMax = unitMax;
+		}
+
+		rangeMin = newMin;
+		rangeMax = newMax;
+		index = unitEnd;
+	}
+
+	// A range that already fits keeps vertexOffset 0, so the common case needs no rebasing
+	ranges.push_back({ rangeStart, levelEnd - rangeStart, rangeMax < MAX_SHORT_VERTEX_SPAN ? 0 : static_cast<int32_t>(rangeMin) });
+
+	size_t newRanges = ranges.size() - firstNewRange;
+	return newRanges == 1 || newRanges <= level.indexCount / MIN_INDICES_PER_RANGE;
+}
+
 std::vector<VkVertexInputBindingDescription> live::Model::Vertex::getBindingDescriptions() {
 	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
 	bindingDescriptions[0].binding   = 0;
@@ -134,18 +605,151 @@ std::vector<VkVertexInputAttributeDescription> live::Model::Vertex::getAttribute
 	return attributeDescriptions;
 }
 
-void live::Model::Builder::loadModels(const std::string& filepame) {
+std::vector<VkVertexInputBindingDescription> live::Model::PackedVertex::getBindingDescriptions() {
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding   = 0;
+	bindingDescriptions[0].stride    = sizeof(PackedVertex);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescriptions;
+}
+
+// Same locations as Vertex so the fragment shaders are shared. RGB16 is not a required vertex
+// format, hence the padded RGBA16 position.
+std::vector<VkVertexInputAttributeDescription> live::Model::PackedVertex::getAttributeDescriptions() {
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+	attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) });
+	attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) });
+	attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+	attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
+
+	return attributeDescriptions;
+}
+
+std::vector<VkVertexInputBindingDescription> live::Model::getPositionBindingDescriptions(VertexFormat vertexFormat) {
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding   = 0;
+	bindingDescriptions[0].stride    = vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex::position) : sizeof(glm::vec3);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> live::Model::getPositionAttributeDescriptions(VertexFormat vertexFormat) {
+	VkFormat format = vertexFormat == VertexFormat::Packed ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+	return { { 0, 0, format, 0 } };
+}
+
+// Parses the file with ObjParser. With one thread the file is streamed, so peak memory is the
+// attribute records plus the output rather than tinyobj's full copy of every face; with more, large
+// files are parsed in parallel chunks that hold their faces until the in-order merge.
+void live::Model::Builder::loadModels(const std::string& filepath, unsigned threadCount) {
+	vertices.clear();
+	indices.clear();
+	lods.clear();
+	meshlets.clear();
+
+	std::vector<uint32_t> triangleMaterials{};
+	BuilderObjSink sink{ vertices, indices, triangleMaterials };
+	ObjParser parser{ sink };
+	parser.parse(filepath, threadCount);
+
+	// Materials used without a definition in any library keep their name and default values
+	materials.assign(1, Material{ "default" });
+	for (const auto& name : parser.getMaterialNames()) {
+		materials.push_back(Material{ name });
+	}
+
+	std::string directory = directoryOf(filepath);
+	for (const auto& library : parser.getMaterialLibraries()) {
+		std::vector<ObjParser::Material> definitions{};
+		try {
+			definitions = ObjParser::parseMaterialLibrary(directory + library);
+		} catch (const std::runtime_error& error) {
+			std::cerr << "Skipping material library: " << error.what() << std::endl;
+			continue;
+		}
+
+		std::string libraryDirectory = directoryOf(directory + library);
+		for (const auto& definition : definitions) {
+			for (size_t i = 1; i < materials.size(); i++) {
+				if (materials[i].name == definition.name) {
+					materials[i].diffuseColor = { definition.diffuse[0], definition.diffuse[1], definition.diffuse[2] };
+					materials[i].diffuseTexture = definition.diffuseTexture.empty() ? std::string{} : libraryDirectory + definition.diffuseTexture;
+				}
+			}
+		}
+	}
+
+	groupByMaterial(triangleMaterials);
+}
+
+// Stable counting sort of the triangles by material: one submesh per used material, in material
+// order, with the file order kept inside each.
+void live::Model::Builder::groupByMaterial(const std::vector<uint32_t>& triangleMaterials) {
+	submeshes.clear();
+	if (indices.empty()) {
+		return;
+	}
+
+	std::vector<uint32_t> materialStarts(materials.size() + 1, 0);
+	for (uint32_t material : triangleMaterials) {
+		materialStarts[material + 1] += 3;
+	}
+	for (size_t material = 0; material < materials.size(); material++) {
+		uint32_t indexCount = materialStarts[material + 1];
+		materialStarts[material + 1] += materialStarts[material];
+		if (indexCount > 0) {
+			submeshes.push_back({ materialStarts[material], indexCount, static_cast<uint32_t>(material) });
+		}
+	}
+
+	if (submeshes.size() > 1) {
+		std::vector<uint32_t> grouped(indices.size());
+		for (size_t triangle = 0; triangle < triangleMaterials.size(); triangle++) {
+			uint32_t& next = materialStarts[triangleMaterials[triangle]];
+			std::copy_n(&indices[triangle * 3], 3, &grouped[next]);
+			next += 3;
+		}
+		indices.swap(grouped);
+	}
+}
+
+uint32_t live::Model::Builder::getSubmeshCount() const {
+	if (submeshes.empty()) {
+		return 1;
+	}
+	return static_cast<uint32_t>(lods.empty() ? submeshes.size() : submeshes.size() / lods.size());
+}
+
+// Gives a hand-filled builder the single default submesh the processing steps expect
+void live::Model::Builder::ensureSubmeshes() {
+	if (materials.empty()) {
+		materials.push_back(Material{ "default" });
+	}
+	if (submeshes.empty() && !indices.empty()) {
+		assert(lods.empty() && "Submeshes must be set up before LODs are generated");
+		submeshes.push_back({ 0, static_cast<uint32_t>(indices.size()), 0 });
+	}
+}
+
+// Original tinyobjloader path, kept as the reference the streaming parser is compared against
+void live::Model::Builder::loadModelsTinyObj(const std::string& filepath) {
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
+	std::vector<tinyobj::material_t> objMaterials;
 	std::string warn, err;
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepame.c_str())) {
+	if (!tinyobj::LoadObj(&attrib, &shapes, &objMaterials, &warn, &err, filepath.c_str())) {
 		throw std::runtime_error(warn + err);
 	}
 
 	vertices.clear();
 	indices.clear();
+	lods.clear();
+	meshlets.clear();
+	// Faces are not split by usemtl here, so everything is drawn with the default material
+	materials.assign(1, Material{ "default" });
+	submeshes.clear();
 
 	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
 
@@ -192,3 +796,154 @@ void live::Model::Builder::loadModels(const std::string& filepame) {
 		}
 	}
 }
+
+
+// Reorders each submesh's triangles for the post-transform cache, then for overdraw, then
+// renumbers vertices in first-use order so vertex fetches walk the buffer linearly.
+live::Model::OptimizationReport live::Model::Builder::optimize() {
+	assert(lods.empty() && meshlets.empty() && "Optimize before generating LODs and meshlets");
+
+	OptimizationReport report{};
+	if (indices.empty()) {
+		return report;
+	}
+	ensureSubmeshes();
+
+	report.before = mesh_optimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+	std::vector<uint32_t> cacheOrdered(indices.size());
+	for (const auto& submesh : submeshes) {
+		mesh_optimizer::optimizeVertexCache(
+			cacheOrdered.data() + submesh.firstIndex,
+			indices.data() + submesh.firstIndex,
+			submesh.indexCount,
+			vertices.size());
+		mesh_optimizer::optimizeOverdraw(
+			indices.data() + submesh.firstIndex,
+			cacheOrdered.data() + submesh.firstIndex,
+			submesh.indexCount,
+			&vertices[0].position.x,
+			vertices.size(),
+			sizeof(Vertex)
+		);
+	}
+
+	std::vector<uint32_t> remap(vertices.size());
+	size_t uniqueVertexCount = mesh_optimizer::optimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertices.size());
+	mesh_optimizer::remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+
+	std::vector<Vertex> remapped(uniqueVertexCount);
+	mesh_optimizer::remapVertexBuffer(remapped.data(), vertices.data(), vertices.size(), sizeof(Vertex), remap.data());
+	vertices.swap(remapped);
+
+	report.after = mesh_optimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	return report;
+}
+
+// Each ratio is simplified from the previous level, so errors accumulate down the chain. Submeshes
+// are simplified separately, which keeps material boundaries as locked borders, and a level's error
+// is the largest of its submeshes. Levels share the vertex buffer and are appended to `indices`;
+// simplification stops early once a level no longer gets smaller.
+void live::Model::Builder::generateLods(const std::vector<float>& ratios) {
+	assert(lods.empty() && "LODs were already generated");
+	assert(meshlets.empty() && "Generate LODs before building meshlets");
+
+	uint32_t baseIndexCount = static_cast<uint32_t>(indices.size());
+	if (baseIndexCount == 0) {
+		lods.push_back({ 0, 0, 0.0f });
+		return;
+	}
+	ensureSubmeshes();
+	lods.push_back({ 0, baseIndexCount, 0.0f });
+
+	const std::vector<SubmeshRange> baseSubmeshes = submeshes;
+	std::vector<std::vector<uint32_t>> sources{};
+	for (const auto& submesh : baseSubmeshes) {
+		sources.emplace_back(indices.begin() + submesh.firstIndex, indices.begin() + submesh.firstIndex + submesh.indexCount);
+	}
+	std::vector<float>    errors(baseSubmeshes.size(), 0.0f);
+	std::vector<uint32_t> simplified{};
+	size_t previousIndexCount = baseIndexCount;
+
+	for (float ratio : ratios) {
+		uint32_t levelStart = static_cast<uint32_t>(indices.size());
+		size_t   levelIndexCount = 0;
+		float    levelError = 0.0f;
+
+		for (size_t i = 0; i < baseSubmeshes.size(); i++) {
+			std::vector<uint32_t>& source = sources[i];
+			size_t targetIndexCount = static_cast<size_t>(baseSubmeshes[i].indexCount * ratio) / 3 * 3;
+
+			simplified.resize(source.size());
+			float  submeshError = 0.0f;
+			size_t indexCount = mesh_optimizer::simplify(
+				simplified.data(),
+				source.data(),
+				source.size(),
+				&vertices[0].position.x,
+				vertices.size(),
+				sizeof(Vertex),
+				targetIndexCount,
+				&submeshError
+			);
+
+			// A submesh that can't shrink further, or would vanish, keeps its previous level
+			if (indexCount > 0 && indexCount < source.size()) {
+				source.resize(indexCount);
+				mesh_optimizer::optimizeVertexCache(source.data(), simplified.data(), indexCount, vertices.size());
+				errors[i] += submeshError;
+			}
+
+			levelIndexCount += source.size();
+			levelError = std::max(levelError, errors[i]);
+		}
+
+		if (levelIndexCount >= previousIndexCount) {
+			break;
+		}
+		previousIndexCount = levelIndexCount;
+
+		for (size_t i = 0; i < baseSubmeshes.size(); i++) {
+			submeshes.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(sources[i].size()), baseSubmeshes[i].material });
+			indices.insert(indices.end(), sources[i].begin(), sources[i].end());
+		}
+		lods.push_back({ levelStart, static_cast<uint32_t>(levelIndexCount), levelError });
+	}
+}
+
+// Reorders each LOD 0 submesh into meshlets for ClusterCuller. Run after optimize and
+// generateLods: the meshlet builder keeps the cache-friendly order within each meshlet, and other
+// LODs are left untouched.
+void live::Model::Builder::buildMeshlets() {
+	if (indices.empty()) {
+		return;
+	}
+	ensureSubmeshes();
+
+	meshlets.clear();
+	std::vector<uint32_t> meshletOrdered{};
+	for (uint32_t i = 0; i < getSubmeshCount(); i++) {
+		SubmeshRange& submesh = submeshes[i];
+		if (submesh.indexCount == 0) {
+			continue;
+		}
+
+		meshletOrdered.resize(submesh.indexCount);
+		auto submeshMeshlets = mesh_optimizer::buildMeshlets(
+			meshletOrdered.data(),
+			indices.data() + submesh.firstIndex,
+			submesh.indexCount,
+			&vertices[0].position.x,
+			vertices.size(),
+			sizeof(Vertex)
+		);
+		std::copy(meshletOrdered.begin(), meshletOrdered.end(), indices.begin() + submesh.firstIndex);
+
+		submesh.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+		submesh.meshletCount = static_cast<uint32_t>(submeshMeshlets.size());
+		for (auto& meshlet : submeshMeshlets) {
+			meshlet.firstIndex += submesh.firstIndex;
+			meshlets.push_back(meshlet);
+		}
+	}
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "buffer.h"
+#include "camera.h"
 #include "engine_device.h"
+#include "material_library.h"
+#include "mesh_optimizer.h"
 
 #define GLM_DEFINE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -12,6 +15,23 @@
 
 
 namespace live {
+	// Vertex layout a model is uploaded with. Packed models need the *_packed shader variants.
+	enum class VertexFormat {
+		Full,    // Model::Vertex, 44 bytes of floats
+		Packed   // Model::PackedVertex, 20 bytes
+	};
+	constexpr size_t VERTEX_FORMAT_COUNT = 2;
+
+	struct ModelLoadOptions {
+		bool         optimize = false;  // run the mesh_optimizer pass, see Model::Builder::optimize
+		VertexFormat vertexFormat = VertexFormat::Full;
+		std::vector<float> lodRatios{};  // triangle ratios of the simplified LODs, e.g. { 0.5f, 0.25f }
+		bool         buildMeshlets = false;  // split LOD 0 into culling clusters, see Builder::buildMeshlets
+		// OBJ parser threads. 1 streams the file with bounded memory; more parse it in parallel chunks
+		// that stay in memory until merged, 0 uses every hardware thread.
+		unsigned     loadThreads = 1;
+	};
+
 	class Model {
 	public:
 		struct Vertex {
@@ -28,35 +48,179 @@ namespace live {
 			}
 		};
 
+		// Positions are unorm16 relative to the model bounds, normals octahedral snorm16, color unorm8
+		// and uv half floats. The position dequantization is folded into the model matrix (see
+		// getDequantizationMatrix), so normals are encoded pre-scaled by the bounds extent to keep the
+		// shaders' normal matrix derivation valid.
+		struct PackedVertex {
+			uint16_t position[4];
+			int16_t  normal[2];
+			uint32_t color;
+			uint32_t uv;
+
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		// Contiguous run of the index buffer drawn with its own vertexOffset. 16-bit index buffers of
+		// meshes with more than 65536 vertices are split into several of these.
+		struct IndexRange {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			int32_t  vertexOffset;
+		};
+
+		struct OptimizationReport {
+			mesh_optimizer::VertexCacheStats before{};
+			mesh_optimizer::VertexCacheStats after{};
+		};
+
+		// Run of `indices` holding one level of detail. error is the simplification error in model units.
+		struct LodLevel {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			float    error;
+		};
+
+		// Run of one LOD's indices drawn with one material, an index into Builder::materials
+		struct SubmeshRange {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t material;
+			uint32_t firstMeshlet = 0;  // meshlets are only built for LOD 0
+			uint32_t meshletCount = 0;
+		};
+
+		// SubmeshRange as drawn: a run of indexRanges, with material resolved to a MaterialLibrary ID
+		// when the model was created with one
+		struct Submesh {
+			uint32_t firstRange;
+			uint32_t rangeCount;
+			uint32_t material;
+			uint32_t firstMeshlet;
+			uint32_t meshletCount;
+		};
+
 		struct Builder {
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
-
-			void loadModels(const std::string& filepame);
+			std::vector<LodLevel> lods{};  // empty means the whole index buffer is LOD 0
+			std::vector<mesh_optimizer::Meshlet> meshlets{};  // clusters of LOD 0, if built
+			std::vector<Material> materials{};  // materials[0] is used by faces without usemtl
+			// Every LOD has the same number of submeshes, one per material in the same order, stored
+			// level after level. Empty means one submesh with material 0 per LOD.
+			std::vector<SubmeshRange> submeshes{};
+
+			// threadCount 1 streams the file with bounded memory, 0 uses every hardware thread
+			void loadModels(const std::string& filepath, unsigned threadCount = 1);
+			void loadModelsTinyObj(const std::string& filepath);
+			OptimizationReport optimize();
+			void generateLods(const std::vector<float>& ratios);
+			void buildMeshlets();
+
+			uint32_t getSubmeshCount() const;
+
+		private:
+			void ensureSubmeshes();
+			void groupByMaterial(const std::vector<uint32_t>& triangleMaterials);
 		};
 
-		Model(LiveDevice& device, const Model::Builder& builder);
+		// With a material library, materials are registered there and submeshes carry library IDs
+		// that are comparable across models; without one they index Builder::materials.
+		Model(
+			LiveDevice& device,
+			const Model::Builder& builder,
+			VertexFormat vertexFormat = VertexFormat::Full,
+			MaterialLibrary* materialLibrary = nullptr);
 		~Model();
 
 		Model(const Model&) = delete;
 		Model& operator=(const Model&) = delete;
 
-		static std::unique_ptr<Model> createModelFromFile(LiveDevice& device, const std::string& filepath);
+		// report, if given, receives the vertex cache statistics of options.optimize
+		static std::unique_ptr<Model> createModelFromFile(
+			LiveDevice& device,
+			const std::string& filepath,
+			const ModelLoadOptions& options = {},
+			MaterialLibrary* materialLibrary = nullptr,
+			OptimizationReport* report = nullptr);
 
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		// Binds the position-only stream instead of the full vertices, for depth-only passes. Same
+		// vertex order and index buffer, so every draw call works unchanged.
+		void bindPositions(VkCommandBuffer commandBuffer);
+		// Vertex input of the position-only stream: a vec3 at location 0
+		static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(VertexFormat vertexFormat);
+		static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions(VertexFormat vertexFormat);
+		// Draws every submesh of the LOD
+		void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0, uint32_t lod = 0);
+		void drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submesh, uint32_t firstInstance = 0, uint32_t lod = 0);
+
+		// Submeshes per LOD, at least one
+		uint32_t getSubmeshCount() const { return submeshCount; }
+		const Submesh& getSubmesh(uint32_t submesh, uint32_t lod = 0) const { return submeshes[lod * submeshCount + submesh]; }
+
+		// View depth of the bounding sphere's nearest point, negative once the camera is inside it
+		float getNearestViewDepth(const Camera& camera, const glm::mat4& modelMatrix) const;
+		// Coarsest LOD whose simplification error projects to at most errorThreshold of the viewport height
+		uint32_t selectLod(const Camera& camera, const glm::mat4& modelMatrix, float errorThreshold) const;
+		uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+
+		// Culling clusters of LOD 0, grouped by submesh, see ClusterCuller
+		const std::vector<mesh_optimizer::Meshlet>& getMeshlets() const { return meshlets; }
+		VkDrawIndexedIndirectCommand getMeshletDrawCommand(uint32_t meshlet, uint32_t firstInstance) const;
+		// Issues drawCount commands, with a single multi-draw where the device supports it
+		void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount);
+
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		VkIndexType getIndexType() const { return indexType; }
+		const std::vector<IndexRange>& getIndexRanges() const { return indexRanges; }
+		// Maps packed positions back to model space; identity for full-precision vertices
+		glm::mat4 getDequantizationMatrix() const;
+
+		glm::vec3 getBoundingCenter() const { return boundingCenter; }
+		float getBoundingRadius() const { return boundingRadius; }
 		
 	private:
+		struct Lod {
+			uint32_t firstRange;
+			uint32_t rangeCount;
+			float    error;
+		};
+
 		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		void createPackedVertexBuffers(const std::vector<Vertex>& vertices);
+		void uploadVertexBuffer(std::unique_ptr<Buffer>& target, const void* vertexData, uint32_t vertexSize, uint32_t count);
+		void computeBoundingSphere(const std::vector<Vertex>& vertices);
+		void createIndexBuffers(const Model::Builder& builder, const std::vector<uint32_t>& materialIds);
+		bool splitIndexRanges16(
+			const std::vector<uint32_t>& indices,
+			const LodLevel& level,
+			const std::vector<uint32_t>& unitEnds,
+			std::vector<IndexRange>& ranges);
 
 		LiveDevice&             liveDevice;
 
+		VertexFormat            vertexFormat = VertexFormat::Full;
+		glm::vec3               boundsMin{ 0.0f };
+		glm::vec3               boundsScale{ 1.0f };
+		glm::vec3               boundingCenter{ 0.0f };
+		float                   boundingRadius = 0.0f;
+
 		std::unique_ptr<Buffer> vertexBuffer;
+		std::unique_ptr<Buffer> positionBuffer;  // float3, or the packed unorm16x4 positions
 		uint32_t                vertexCount;
 
 		bool                    hasIndexBuffer = false;
 		std::unique_ptr<Buffer> indexBuffer;
 		uint32_t                indexCount;
+		VkIndexType             indexType = VK_INDEX_TYPE_UINT32;
+		std::vector<IndexRange> indexRanges{};
+		std::vector<Lod>        lods{};
+		std::vector<Submesh>    submeshes{};
+		uint32_t                submeshCount = 1;
+
+		std::vector<mesh_optimizer::Meshlet> meshlets{};
+		std::vector<int32_t>                 meshletVertexOffsets{};
 	};
 }
\ No newline at end of file
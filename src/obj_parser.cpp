@@ -0,0 +1,532 @@
+#include "obj_parser.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+
+namespace live {
+	namespace {
+		bool isSpace(char c) {
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		const char* skipSpaces(const char* cursor, const char* end) {
+			while (cursor < end && isSpace(*cursor)) {
+				cursor++;
+			}
+			return cursor;
+		}
+
+		// std::from_chars is the Eisel-Lemire/fast_float algorithm in current standard libraries,
+		// locale independent and non-allocating. Returns nullptr if no number could be read.
+		const char* parseFloat(const char* cursor, const char* end, float& value) {
+			cursor = skipSpaces(cursor, end);
+			if (cursor < end && *cursor == '+') {
+				cursor++;
+			}
+			auto result = std::from_chars(cursor, end, value);
+			return result.ec == std::errc{} ? result.ptr : nullptr;
+		}
+
+		const char* parseInt(const char* cursor, const char* end, int32_t& value) {
+			if (cursor < end && *cursor == '+') {
+				cursor++;
+			}
+			auto result = std::from_chars(cursor, end, value);
+			return result.ec == std::errc{} ? result.ptr : nullptr;
+		}
+
+		enum class RecordType { Other, Position, Normal, Texcoord, Face, UseMaterial, MaterialLibrary };
+
+		bool startsWithKeyword(const char* cursor, const char* end, const char* keyword) {
+			size_t length = std::strlen(keyword);
+			return static_cast<size_t>(end - cursor) > length && std::memcmp(cursor, keyword, length) == 0 && isSpace(cursor[length]);
+		}
+
+		// Classifies the line and moves cursor past the record keyword
+		RecordType readRecordType(const char*& cursor, const char* end) {
+			cursor = skipSpaces(cursor, end);
+			if (end - cursor < 2) {
+				return RecordType::Other;
+			}
+
+			if (cursor[0] == 'v' && isSpace(cursor[1])) {
+				cursor += 1;
+				return RecordType::Position;
+			} else if (cursor[0] == 'v' && cursor[1] == 'n') {
+				cursor += 2;
+				return RecordType::Normal;
+			} else if (cursor[0] == 'v' && cursor[1] == 't') {
+				cursor += 2;
+				return RecordType::Texcoord;
+			} else if (cursor[0] == 'f' && isSpace(cursor[1])) {
+				cursor += 1;
+				return RecordType::Face;
+			} else if (startsWithKeyword(cursor, end, "usemtl")) {
+				cursor += 6;
+				return RecordType::UseMaterial;
+			} else if (startsWithKeyword(cursor, end, "mtllib")) {
+				cursor += 6;
+				return RecordType::MaterialLibrary;
+			}
+			return RecordType::Other;
+		}
+
+		// Rest of the line without surrounding whitespace
+		std::string readName(const char* cursor, const char* end) {
+			cursor = skipSpaces(cursor, end);
+			while (end > cursor && isSpace(end[-1])) {
+				end--;
+			}
+			return std::string(cursor, end);
+		}
+
+		// mtllib takes a space separated list of file names
+		void readNames(const char* cursor, const char* end, std::vector<std::string>& names) {
+			while ((cursor = skipSpaces(cursor, end)) < end) {
+				const char* nameEnd = cursor;
+				while (nameEnd < end && !isSpace(*nameEnd)) {
+					nameEnd++;
+				}
+				names.emplace_back(cursor, nameEnd);
+				cursor = nameEnd;
+			}
+		}
+
+		template<size_t N>
+		bool parseFloats(const char* cursor, const char* end, std::vector<float>& destination) {
+			float values[N];
+			for (float& value : values) {
+				if ((cursor = parseFloat(cursor, end, value)) == nullptr) {
+					return false;
+				}
+			}
+			destination.insert(destination.end(), values, values + N);
+			return true;
+		}
+
+		bool parsePosition(const char* cursor, const char* end, ObjParser::Attributes& attributes) {
+			float position[3];
+			for (float& component : position) {
+				if ((cursor = parseFloat(cursor, end, component)) == nullptr) {
+					return false;
+				}
+			}
+			attributes.positions.insert(attributes.positions.end(), position, position + 3);
+
+			// Optional "v x y z r g b" vertex colors; positions without one default to white
+			float color[3];
+			bool hasColor = true;
+			for (float& component : color) {
+				if (hasColor && (cursor = parseFloat(cursor, end, component)) == nullptr) {
+					hasColor = false;
+				}
+			}
+			if (hasColor) {
+				attributes.colors.resize(attributes.positions.size() - 3, 1.0f);
+				attributes.colors.insert(attributes.colors.end(), color, color + 3);
+			} else if (!attributes.colors.empty()) {
+				attributes.colors.resize(attributes.positions.size(), 1.0f);
+			}
+			return true;
+		}
+
+		bool parseAttribute(RecordType type, const char* cursor, const char* end, ObjParser::Attributes& attributes) {
+			switch (type) {
+			case RecordType::Position:
+				return parsePosition(cursor, end, attributes);
+			case RecordType::Normal:
+				return parseFloats<3>(cursor, end, attributes.normals);
+			case RecordType::Texcoord:
+				return parseFloats<2>(cursor, end, attributes.texcoords);
+			default:
+				return true;
+			}
+		}
+
+		// Reads v, v/vt, v//vn or v/vt/vn as the raw OBJ values, 0 where an attribute is missing
+		const char* parseRawIndex(const char* cursor, const char* end, ObjParser::Index& index) {
+			index = { 0, 0, 0 };
+			if ((cursor = parseInt(cursor, end, index.position)) == nullptr || index.position == 0) {
+				return nullptr;
+			}
+
+			if (cursor == end || *cursor != '/') {
+				return cursor;
+			}
+			cursor++;
+
+			if (cursor < end && *cursor != '/') {
+				if ((cursor = parseInt(cursor, end, index.texcoord)) == nullptr || index.texcoord == 0) {
+					return nullptr;
+				}
+			}
+
+			if (cursor == end || *cursor != '/') {
+				return cursor;
+			}
+			cursor++;
+
+			if ((cursor = parseInt(cursor, end, index.normal)) == nullptr || index.normal == 0) {
+				return nullptr;
+			}
+			return cursor;
+		}
+
+		// OBJ indices are one-based, negative ones count back from the last record read so far.
+		// Raw 0 means the attribute is absent and resolves to -1.
+		bool resolveIndex(int32_t raw, size_t recordCount, int32_t& resolved) {
+			if (raw == 0) {
+				resolved = -1;
+				return true;
+			}
+			int64_t index = raw > 0 ? int64_t{ raw } - 1 : static_cast<int64_t>(recordCount) + raw;
+			resolved = static_cast<int32_t>(index);
+			return index >= 0 && static_cast<size_t>(index) < recordCount;
+		}
+
+		// Records of each attribute read before a face
+		struct RecordCounts {
+			size_t positions;
+			size_t texcoords;
+			size_t normals;
+		};
+
+		bool resolveCorner(const ObjParser::Index& raw, const RecordCounts& counts, ObjParser::Index& resolved) {
+			return resolveIndex(raw.position, counts.positions, resolved.position) &&
+				resolveIndex(raw.texcoord, counts.texcoords, resolved.texcoord) &&
+				resolveIndex(raw.normal, counts.normals, resolved.normal);
+		}
+
+		RecordCounts countRecords(const ObjParser::Attributes& attributes) {
+			return { attributes.positions.size() / 3, attributes.texcoords.size() / 2, attributes.normals.size() / 3 };
+		}
+
+		template<typename T>
+		void append(std::vector<T>& destination, const std::vector<T>& source) {
+			destination.insert(destination.end(), source.begin(), source.end());
+		}
+	}
+
+	// One line-aligned slice of the input. Indices are kept raw because the attribute counts of the
+	// preceding chunks are only known after every chunk has been parsed.
+	struct ObjParser::Chunk {
+		// Chunk-local line and record counts are stored per face so negative indices and error
+		// lines can be rebased during the merge
+		struct Face {
+			uint32_t     cornerCount;
+			size_t       line;
+			RecordCounts counts;
+			int32_t      material;  // into materialNames, -1 before the chunk's first usemtl
+		};
+
+		const char*        begin = nullptr;
+		const char*        end = nullptr;
+
+		Attributes         attributes{};
+		std::vector<Index> corners{};
+		std::vector<Face>  faces{};
+		std::vector<std::string> materialNames{};
+		std::vector<std::string> materialLibraries{};
+		int32_t            material = -1;
+		size_t             lineCount = 0;
+		size_t             malformedLine = 0;  // chunk-local, 0 if the chunk parsed cleanly
+		bool               malformedFace = false;
+		std::exception_ptr error{};
+
+		void parse() {
+			try {
+				const char* cursor = begin;
+				while (cursor < end) {
+					const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+					if (lineEnd == nullptr) {
+						lineEnd = end;
+					}
+
+					lineCount++;
+					if (!parseLine(cursor, lineEnd)) {
+						malformedLine = lineCount;
+						return;
+					}
+					cursor = lineEnd + 1;
+				}
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+
+		bool parseLine(const char* cursor, const char* lineEnd) {
+			RecordType type = readRecordType(cursor, lineEnd);
+			if (type == RecordType::UseMaterial) {
+				// A chunk rarely switches materials more than a few times, so a linear search will do
+				std::string name = readName(cursor, lineEnd);
+				auto found = std::find(materialNames.begin(), materialNames.end(), name);
+				material = static_cast<int32_t>(found - materialNames.begin());
+				if (found == materialNames.end()) {
+					materialNames.push_back(std::move(name));
+				}
+				return true;
+			} else if (type == RecordType::MaterialLibrary) {
+				readNames(cursor, lineEnd, materialLibraries);
+				return true;
+			} else if (type != RecordType::Face) {
+				return parseAttribute(type, cursor, lineEnd, attributes);
+			}
+
+			Face face{ 0, lineCount, countRecords(attributes), material };
+			while ((cursor = skipSpaces(cursor, lineEnd)) < lineEnd) {
+				Index index{};
+				if ((cursor = parseRawIndex(cursor, lineEnd, index)) == nullptr) {
+					malformedFace = true;
+					return false;
+				}
+				corners.push_back(index);
+				face.cornerCount++;
+			}
+			faces.push_back(face);
+			return true;
+		}
+	};
+
+	void ObjParser::parse(const std::string& filepath, unsigned threadCount) {
+		MappedFile file{ filepath };
+		try {
+			parseBuffer(file.data(), file.size(), threadCount);
+		} catch (const std::runtime_error& error) {
+			throw std::runtime_error(filepath + ": " + error.what());
+		}
+	}
+
+	void ObjParser::parseBuffer(const char* data, size_t size, unsigned threadCount) {
+		if (threadCount == 0) {
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		size_t chunkCount = std::min<size_t>(threadCount, size / MIN_CHUNK_SIZE);
+		if (chunkCount > 1) {
+			parseParallel(data, size, static_cast<unsigned>(chunkCount));
+		} else {
+			parseSerial(data, size);
+		}
+	}
+
+	void ObjParser::parseSerial(const char* data, size_t size) {
+		const char* cursor = data;
+		const char* end = data + size;
+
+		while (cursor < end) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+			if (lineEnd == nullptr) {
+				lineEnd = end;
+			}
+
+			lineNumber++;
+			parseLine(cursor, lineEnd);
+			cursor = lineEnd + 1;
+		}
+	}
+
+	void ObjParser::parseParallel(const char* data, size_t size, unsigned chunkCount) {
+		const char* end = data + size;
+
+		// Even byte split, with every boundary moved past the next newline
+		std::vector<Chunk> chunks(chunkCount);
+		const char* cursor = data;
+		for (unsigned i = 0; i < chunkCount; i++) {
+			chunks[i].begin = cursor;
+			if (i + 1 < chunkCount) {
+				const char* target = std::max(cursor, data + size / chunkCount * (i + 1));
+				const char* newline = static_cast<const char*>(std::memchr(target, '\n', end - target));
+				cursor = newline != nullptr ? newline + 1 : end;
+			} else {
+				cursor = end;
+			}
+			chunks[i].end = cursor;
+		}
+
+		std::vector<std::thread> workers{};
+		workers.reserve(chunkCount - 1);
+		for (unsigned i = 1; i < chunkCount; i++) {
+			workers.emplace_back(&Chunk::parse, &chunks[i]);
+		}
+		chunks[0].parse();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		size_t lineBase = lineNumber;
+		for (const auto& chunk : chunks) {
+			if (chunk.error) {
+				std::rethrow_exception(chunk.error);
+			}
+			if (chunk.malformedLine != 0) {
+				throw std::runtime_error(
+					std::string(chunk.malformedFace ? "malformed face" : "malformed record") +
+					" on line " + std::to_string(lineBase + chunk.malformedLine));
+			}
+			lineBase += chunk.lineCount;
+		}
+
+		// Attributes are concatenated in file order. Vertex colors are all or nothing across the
+		// file, so chunks without any are padded with white if another chunk has them.
+		bool hasColors = std::any_of(chunks.begin(), chunks.end(), [](const Chunk& chunk) {
+			return !chunk.attributes.colors.empty();
+		});
+		std::vector<RecordCounts> bases(chunkCount);
+		for (unsigned i = 0; i < chunkCount; i++) {
+			bases[i] = countRecords(attributes);
+			append(materialLibraries, chunks[i].materialLibraries);
+			const Attributes& chunkAttributes = chunks[i].attributes;
+			if (hasColors) {
+				attributes.colors.resize(attributes.positions.size(), 1.0f);
+				append(attributes.colors, chunkAttributes.colors);
+			}
+			append(attributes.positions, chunkAttributes.positions);
+			append(attributes.normals, chunkAttributes.normals);
+			append(attributes.texcoords, chunkAttributes.texcoords);
+		}
+		if (hasColors) {
+			attributes.colors.resize(attributes.positions.size(), 1.0f);
+		}
+
+		// Faces are emitted in file order so the sink sees the same stream as the serial path. Each
+		// chunk is released as soon as it has been merged.
+		for (unsigned i = 0; i < chunkCount; i++) {
+			Chunk& chunk = chunks[i];
+			const RecordCounts& base = bases[i];
+			const Index* corners = chunk.corners.data();
+
+			std::vector<uint32_t> materials(chunk.materialNames.size());
+			for (size_t material = 0; material < materials.size(); material++) {
+				materials[material] = findMaterial(chunk.materialNames[material]);
+			}
+
+			for (const auto& face : chunk.faces) {
+				if (face.material >= 0) {
+					useMaterial(materials[face.material]);
+				}
+
+				RecordCounts counts{
+					base.positions + face.counts.positions,
+					base.texcoords + face.counts.texcoords,
+					base.normals + face.counts.normals
+				};
+
+				polygon.resize(face.cornerCount);
+				for (uint32_t corner = 0; corner < face.cornerCount; corner++) {
+					if (!resolveCorner(corners[corner], counts, polygon[corner])) {
+						throw std::runtime_error("malformed face on line " + std::to_string(lineNumber + face.line));
+					}
+				}
+				corners += face.cornerCount;
+
+				for (size_t corner = 2; corner < polygon.size(); corner++) {
+					const Index triangle[3] = { polygon[0], polygon[corner - 1], polygon[corner] };
+					sink.onTriangle(attributes, triangle);
+				}
+			}
+			// A usemtl after the chunk's last face still applies to the next chunk's first faces
+			if (chunk.material >= 0) {
+				useMaterial(materials[chunk.material]);
+			}
+
+			lineNumber += chunk.lineCount;
+			chunk = Chunk{};
+		}
+	}
+
+	void ObjParser::parseLine(const char* begin, const char* end) {
+		const char* cursor = begin;
+		RecordType type = readRecordType(cursor, end);
+		if (type == RecordType::Face) {
+			parseFace(cursor, end);
+		} else if (type == RecordType::UseMaterial) {
+			useMaterial(findMaterial(readName(cursor, end)));
+		} else if (type == RecordType::MaterialLibrary) {
+			readNames(cursor, end, materialLibraries);
+		} else if (!parseAttribute(type, cursor, end, attributes)) {
+			throw std::runtime_error("malformed record on line " + std::to_string(lineNumber));
+		}
+	}
+
+	void ObjParser::parseFace(const char* cursor, const char* end) {
+		polygon.clear();
+
+		RecordCounts counts = countRecords(attributes);
+		while ((cursor = skipSpaces(cursor, end)) < end) {
+			Index raw{};
+			Index index{};
+			cursor = parseRawIndex(cursor, end, raw);
+			if (cursor == nullptr || !resolveCorner(raw, counts, index)) {
+				throw std::runtime_error("malformed face on line " + std::to_string(lineNumber));
+			}
+			polygon.push_back(index);
+		}
+
+		for (size_t i = 2; i < polygon.size(); i++) {
+			const Index corners[3] = { polygon[0], polygon[i - 1], polygon[i] };
+			sink.onTriangle(attributes, corners);
+		}
+	}
+
+	uint32_t ObjParser::findMaterial(const std::string& name) {
+		auto found = materialLookup.find(name);
+		if (found != materialLookup.end()) {
+			return found->second;
+		}
+
+		uint32_t material = static_cast<uint32_t>(materialNames.size());
+		materialNames.push_back(name);
+		materialLookup.emplace(name, material);
+		return material;
+	}
+
+	void ObjParser::useMaterial(uint32_t material) {
+		if (material != currentMaterial) {
+			currentMaterial = material;
+			sink.onMaterial(material);
+		}
+	}
+
+	// Only what the engine uses is read: the material names and their diffuse color and texture
+	std::vector<ObjParser::Material> ObjParser::parseMaterialLibrary(const std::string& filepath) {
+		MappedFile file{ filepath };
+		const char* cursor = file.data();
+		const char* end = cursor + file.size();
+
+		std::vector<Material> materials{};
+		size_t lineNumber = 0;
+		while (cursor < end) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+			if (lineEnd == nullptr) {
+				lineEnd = end;
+			}
+			lineNumber++;
+
+			const char* record = skipSpaces(cursor, lineEnd);
+			if (startsWithKeyword(record, lineEnd, "newmtl")) {
+				materials.push_back({ readName(record + 6, lineEnd) });
+			} else if (!materials.empty() && startsWithKeyword(record, lineEnd, "Kd")) {
+				std::vector<float> diffuse{};
+				if (!parseFloats<3>(record + 2, lineEnd, diffuse)) {
+					throw std::runtime_error(filepath + ": malformed record on line " + std::to_string(lineNumber));
+				}
+				std::copy(diffuse.begin(), diffuse.end(), materials.back().diffuse);
+			} else if (!materials.empty() && startsWithKeyword(record, lineEnd, "map_Kd")) {
+				// Options such as -s or -bm come first, the file name is the last token
+				std::vector<std::string> tokens{};
+				readNames(record + 6, lineEnd, tokens);
+				if (!tokens.empty()) {
+					materials.back().diffuseTexture = tokens.back();
+				}
+			}
+			cursor = lineEnd + 1;
+		}
+		return materials;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace live {
+	// Streaming Wavefront OBJ reader. The file is memory mapped and parsed line by line; attribute
+	// records (v/vt/vn) are kept because faces refer back to them, but faces are never stored: each
+	// triangle is handed to the sink as soon as its `f` record is read. Polygons are fan-triangulated.
+	// usemtl switches are reported to the sink and mtllib names are collected; other records such as
+	// o, g and s are skipped.
+	//
+	// With more than one thread the input is split at line boundaries into chunks that are parsed
+	// concurrently and then merged in file order, so the sink sees exactly the serial triangle
+	// stream. That path keeps each chunk's faces until the merge, trading the bounded memory of the
+	// serial path for throughput.
+	class ObjParser {
+	public:
+		// Zero-based attribute indices of one face corner, -1 when the corner has no such attribute
+		struct Index {
+			int32_t position = -1;
+			int32_t texcoord = -1;
+			int32_t normal = -1;
+
+			bool operator==(const Index& other) const {
+				return position == other.position && texcoord == other.texcoord && normal == other.normal;
+			}
+		};
+
+		struct Attributes {
+			std::vector<float> positions{};  // xyz
+			std::vector<float> colors{};     // rgb per position, empty if the file has no vertex colors
+			std::vector<float> normals{};    // xyz
+			std::vector<float> texcoords{};  // uv
+		};
+
+		// Subset of an MTL material
+		struct Material {
+			std::string name{};
+			float       diffuse[3] = { 1.0f, 1.0f, 1.0f };  // Kd
+			std::string diffuseTexture{};                   // map_Kd, relative to the MTL file
+		};
+
+		// Material of triangles before the first usemtl
+		static constexpr uint32_t NO_MATERIAL = ~0u;
+
+		class Sink {
+		public:
+			virtual ~Sink() = default;
+			virtual void onTriangle(const Attributes& attributes, const Index (&corners)[3]) = 0;
+			// The following triangles use getMaterialNames()[material]
+			virtual void onMaterial(uint32_t /*material*/) {}
+		};
+
+		explicit ObjParser(Sink& sink) : sink{ sink } {}
+
+		// Inputs smaller than MIN_CHUNK_SIZE per thread use fewer threads, down to the serial path
+		static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+		// threadCount 0 uses every hardware thread
+		void parse(const std::string& filepath, unsigned threadCount = 1);
+		void parseBuffer(const char* data, size_t size, unsigned threadCount = 1);
+
+		const Attributes& getAttributes() const { return attributes; }
+		// In order of first usemtl
+		const std::vector<std::string>& getMaterialNames() const { return materialNames; }
+		// mtllib file names, relative to the OBJ file
+		const std::vector<std::string>& getMaterialLibraries() const { return materialLibraries; }
+
+		static std::vector<Material> parseMaterialLibrary(const std::string& filepath);
+
+	private:
+		struct Chunk;
+
+		void parseSerial(const char* data, size_t size);
+		void parseParallel(const char* data, size_t size, unsigned chunkCount);
+		void parseLine(const char* begin, const char* end);
+		void parseFace(const char* cursor, const char* end);
+		uint32_t findMaterial(const std::string& name);
+		void useMaterial(uint32_t material);
+
+		Sink&              sink;
+		Attributes         attributes{};
+		std::vector<Index> polygon{};
+		size_t             lineNumber = 0;
+
+		std::vector<std::string>                  materialNames{};
+		std::unordered_map<std::string, uint32_t> materialLookup{};
+		std::vector<std::string>                  materialLibraries{};
+		uint32_t                                  currentMaterial = NO_MATERIAL;
+	};
+}
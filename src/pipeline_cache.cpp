@@ -0,0 +1,332 @@
+#include "pipeline_cache.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace live {
+	namespace {
+		bool sameBindings(const std::vector<VkVertexInputBindingDescription>& a, const std::vector<VkVertexInputBindingDescription>& b) {
+			if (a.size() != b.size()) {
+				return false;
+			}
+			for (size_t i = 0; i < a.size(); i++) {
+				if (a[i].binding != b[i].binding || a[i].stride != b[i].stride || a[i].inputRate != b[i].inputRate) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool sameAttributes(const std::vector<VkVertexInputAttributeDescription>& a, const std::vector<VkVertexInputAttributeDescription>& b) {
+			if (a.size() != b.size()) {
+				return false;
+			}
+			for (size_t i = 0; i < a.size(); i++) {
+				if (a[i].location != b[i].location || a[i].binding != b[i].binding ||
+					a[i].format != b[i].format || a[i].offset != b[i].offset) {
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	bool PipelineState::operator==(const PipelineState& other) const {
+		return pipelineLayout == other.pipelineLayout &&
+			renderPass == other.renderPass &&
+			subpass == other.subpass &&
+			colorFormat == other.colorFormat &&
+			depthFormat == other.depthFormat &&
+			program == other.program &&
+			vertexLayout == other.vertexLayout &&
+			topology == other.topology &&
+			polygonMode == other.polygonMode &&
+			cullMode == other.cullMode &&
+			frontFace == other.frontFace &&
+			depthTest == other.depthTest &&
+			depthWrite == other.depthWrite &&
+			depthCompareOp == other.depthCompareOp &&
+			blendMode == other.blendMode &&
+			colorAttachmentCount == other.colorAttachmentCount;
+	}
+
+	size_t PipelineCache::StateHash::operator()(const PipelineState& state) const {
+		size_t seed = 0;
+		hashCombine(
+			seed,
+			state.pipelineLayout,
+			state.renderPass,
+			state.subpass,
+			static_cast<uint32_t>(state.colorFormat),
+			static_cast<uint32_t>(state.depthFormat),
+			state.program,
+			state.vertexLayout,
+			static_cast<uint32_t>(state.topology),
+			static_cast<uint32_t>(state.polygonMode),
+			static_cast<uint32_t>(state.cullMode),
+			static_cast<uint32_t>(state.frontFace),
+			state.depthTest,
+			state.depthWrite,
+			static_cast<uint32_t>(state.depthCompareOp),
+			static_cast<uint32_t>(state.blendMode),
+			state.colorAttachmentCount);
+		return seed;
+	}
+
+	PipelineCache::PipelineCache(LiveDevice& device, unsigned threadCount) : liveDevice{ device } {
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+		if (vkCreatePipelineCache(liveDevice.device(), &cacheInfo, nullptr, &driverCache) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline cache.");
+		}
+
+		if (threadCount == 0) {
+			threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+		workers.reserve(threadCount);
+		for (unsigned i = 0; i < threadCount; i++) {
+			workers.emplace_back(&PipelineCache::workerLoop, this);
+		}
+	}
+
+	// Queued jobs are dropped and running ones finish first. The pipelines defer their own
+	// destruction; the driver cache is not referenced by pipelines once they are created.
+	PipelineCache::~PipelineCache() {
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+			jobs.clear();
+		}
+		jobQueued.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		compiled.clear();
+		pipelines.clear();
+		vkDestroyPipelineCache(liveDevice.device(), driverCache, nullptr);
+	}
+
+	uint32_t PipelineCache::registerProgram(const std::string& vertFilePath, const std::string& fragFilePath) {
+		for (uint32_t i = 0; i < programs.size(); i++) {
+			if (programs[i].vertFilePath == vertFilePath && programs[i].fragFilePath == fragFilePath) {
+				return i;
+			}
+		}
+
+		programs.push_back({ vertFilePath, fragFilePath });
+		return static_cast<uint32_t>(programs.size() - 1);
+	}
+
+	uint32_t PipelineCache::registerVertexLayout(
+		const std::vector<VkVertexInputBindingDescription>& bindingDescriptions,
+		const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
+		for (uint32_t i = 0; i < vertexLayouts.size(); i++) {
+			if (sameBindings(vertexLayouts[i].bindingDescriptions, bindingDescriptions) &&
+				sameAttributes(vertexLayouts[i].attributeDescriptions, attributeDescriptions)) {
+				return i;
+			}
+		}
+
+		vertexLayouts.push_back({ bindingDescriptions, attributeDescriptions });
+		return static_cast<uint32_t>(vertexLayouts.size() - 1);
+	}
+
+	LivePipeline* PipelineCache::getPipeline(const PipelineState& state) {
+		if (lastPipeline != nullptr && state == lastState) {
+			return lastPipeline;
+		}
+
+		auto found = pipelines.find(state);
+		if (found == pipelines.end()) {
+			found = pipelines.emplace(state, Entry{ createPipeline(makeJob(state)), false }).first;
+		}
+		// A failed compilation of this state erases it, but collectCompiled throws before the
+		// iterator is used again
+		while (found->second.pending) {
+			waitForCompiled();
+		}
+
+		lastState = state;
+		lastPipeline = found->second.pipeline.get();
+		return lastPipeline;
+	}
+
+	LivePipeline* PipelineCache::requestPipeline(const PipelineState& state) {
+		if (lastPipeline != nullptr && state == lastState) {
+			return lastPipeline;
+		}
+
+		Entry& entry = pipelines[state];
+		if (entry.pipeline == nullptr) {
+			if (!entry.pending) {
+				enqueue(state, entry);
+			}
+			return nullptr;
+		}
+
+		lastState = state;
+		lastPipeline = entry.pipeline.get();
+		return lastPipeline;
+	}
+
+	void PipelineCache::warmUp(const std::vector<PipelineState>& states) {
+		for (const auto& state : states) {
+			Entry& entry = pipelines[state];
+			if (entry.pipeline == nullptr && !entry.pending) {
+				enqueue(state, entry);
+			}
+		}
+
+		auto anyPending = [&]() {
+			return std::any_of(states.begin(), states.end(), [&](const PipelineState& state) {
+				auto found = pipelines.find(state);
+				return found != pipelines.end() && found->second.pending;
+			});
+		};
+		while (anyPending()) {
+			waitForCompiled();
+		}
+	}
+
+	void PipelineCache::collectCompiled() {
+		std::vector<CompiledPipeline> finished{};
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			finished.swap(compiled);
+		}
+
+		std::exception_ptr error{};
+		for (auto& result : finished) {
+			auto found = pipelines.find(result.state);
+			assert(found != pipelines.end() && found->second.pending && "Compiled pipeline was not requested");
+			pendingCount--;
+			if (result.error) {
+				// Forget the state so a later request tries again
+				pipelines.erase(found);
+				error = result.error;
+				continue;
+			}
+			found->second.pipeline = std::move(result.pipeline);
+			found->second.pending = false;
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void PipelineCache::enqueue(const PipelineState& state, Entry& entry) {
+		entry.pending = true;
+		pendingCount++;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			jobs.push_back(makeJob(state));
+		}
+		jobQueued.notify_one();
+	}
+
+	void PipelineCache::waitForCompiled() {
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			jobCompiled.wait(lock, [&]() { return !compiled.empty(); });
+		}
+		collectCompiled();
+	}
+
+	void PipelineCache::workerLoop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				jobQueued.wait(lock, [&]() { return stopping || !jobs.empty(); });
+				if (stopping) {
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			CompiledPipeline result{ job.state, nullptr, nullptr };
+			try {
+				result.pipeline = createPipeline(job);
+			} catch (...) {
+				result.error = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				compiled.push_back(std::move(result));
+			}
+			jobCompiled.notify_all();
+		}
+	}
+
+	PipelineCache::Job PipelineCache::makeJob(const PipelineState& state) const {
+		assert(state.program < programs.size() && "Pipeline state refers to an unregistered program");
+		assert(state.vertexLayout < vertexLayouts.size() && "Pipeline state refers to an unregistered vertex layout");
+		return { state, programs[state.program], vertexLayouts[state.vertexLayout] };
+	}
+
+	// Runs on the worker threads: reads nothing but the job and the device
+	std::unique_ptr<LivePipeline> PipelineCache::createPipeline(const Job& job) const {
+		const PipelineState& state = job.state;
+		assert(state.colorAttachmentCount <= 1 && "Pipeline states describe at most one color attachment");
+
+		PipelineConfigInfo config{};
+		LivePipeline::defaultPipelineConfigInfo(config);
+		config.pipelineLayout = state.pipelineLayout;
+		config.renderPass = state.renderPass;
+		config.subpass = state.subpass;
+		config.driverCache = driverCache;
+		if (state.renderPass == VK_NULL_HANDLE) {
+			config.colorAttachmentFormats.assign(state.colorAttachmentCount, state.colorFormat);
+			config.depthAttachmentFormat = state.depthFormat;
+		}
+
+		config.bindingDescriptions = job.vertexLayout.bindingDescriptions;
+		config.attributeDescriptions = job.vertexLayout.attributeDescriptions;
+
+		config.inputAssemblyInfo.topology = state.topology;
+		config.rasterizationInfo.polygonMode = state.polygonMode;
+		config.rasterizationInfo.cullMode = state.cullMode;
+		config.rasterizationInfo.frontFace = state.frontFace;
+		config.depthStencilInfo.depthTestEnable = state.depthTest;
+		config.depthStencilInfo.depthWriteEnable = state.depthWrite;
+		config.depthStencilInfo.depthCompareOp = state.depthCompareOp;
+
+		switch (state.blendMode) {
+		case BlendMode::Opaque:
+			break;
+		case BlendMode::Alpha:
+			config.colorBlendAttachment.blendEnable = VK_TRUE;
+			config.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			config.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			config.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			config.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			break;
+		case BlendMode::Additive:
+			config.colorBlendAttachment.blendEnable = VK_TRUE;
+			config.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			config.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			config.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			config.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			break;
+		}
+
+		// Vertex-only programs may still run where a color attachment is bound, as in a dynamic
+		// rendering scope shared with the color pass; they must leave it untouched
+		if (job.program.fragFilePath.empty()) {
+			config.colorBlendAttachment.colorWriteMask = 0;
+		}
+
+		config.colorBlendInfo.attachmentCount = state.colorAttachmentCount;
+		config.colorBlendInfo.pAttachments = state.colorAttachmentCount > 0 ? &config.colorBlendAttachment : nullptr;
+
+		return std::make_unique<LivePipeline>(liveDevice, job.program.vertFilePath, job.program.fragFilePath, config);
+	}
+}
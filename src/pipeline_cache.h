@@ -0,0 +1,151 @@
+#pragma once
+
+#include "engine_device.h"
+#include "live_pipeline.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace live {
+	// Color blend equations a PipelineState can select
+	enum class BlendMode : uint32_t {
+		Opaque,
+		Alpha,     // src * a + dst * (1 - a)
+		Additive   // src * a + dst
+	};
+
+	// Canonical description of a graphics pipeline: shaders and vertex input by ID, and the
+	// fixed-function state render systems vary. Everything not listed comes from
+	// LivePipeline::defaultPipelineConfigInfo, and the defaults here match it.
+	struct PipelineState {
+		VkPipelineLayout    pipelineLayout = VK_NULL_HANDLE;
+		VkRenderPass        renderPass = VK_NULL_HANDLE;  // the pipeline works with any compatible render pass
+		uint32_t            subpass = 0;
+		// Without a render pass, the attachment formats of the dynamic rendering scope
+		VkFormat            colorFormat = VK_FORMAT_UNDEFINED;
+		VkFormat            depthFormat = VK_FORMAT_UNDEFINED;
+		uint32_t            program = 0;       // from PipelineCache::registerProgram
+		uint32_t            vertexLayout = 0;  // from PipelineCache::registerVertexLayout
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkPolygonMode       polygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags     cullMode = VK_CULL_MODE_NONE;
+		VkFrontFace         frontFace = VK_FRONT_FACE_CLOCKWISE;
+		VkBool32            depthTest = VK_TRUE;
+		VkBool32            depthWrite = VK_TRUE;
+		VkCompareOp         depthCompareOp = VK_COMPARE_OP_LESS;
+		BlendMode           blendMode = BlendMode::Opaque;
+		uint32_t            colorAttachmentCount = 1;  // 0 for depth-only subpasses
+
+		bool operator==(const PipelineState& other) const;
+		bool operator!=(const PipelineState& other) const { return !(*this == other); }
+	};
+
+	// Creates pipelines on demand and keeps them for the cache's lifetime, so render systems can ask
+	// for whatever state a draw needs instead of building each variant by hand. Shader paths and
+	// vertex input are registered once and referred to by ID, which keeps states small enough to
+	// hash and compare per draw. Creation goes through a shared VkPipelineCache, so variants of one
+	// program reuse the driver's compiled shaders.
+	//
+	// Pipelines can be created on the calling thread (getPipeline) or on a pool of background threads
+	// (requestPipeline, warmUp). Finished background pipelines are handed over to the cache in
+	// collectCompiled, so everything but the compilation itself stays on the owning thread.
+	class PipelineCache {
+	public:
+		// threadCount 0 uses every hardware thread but one
+		explicit PipelineCache(LiveDevice& device, unsigned threadCount = 0);
+		~PipelineCache();
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		// Same paths, same ID. An empty fragFilePath registers a vertex-only program for depth passes.
+		uint32_t registerProgram(const std::string& vertFilePath, const std::string& fragFilePath);
+		// Same descriptions, same ID
+		uint32_t registerVertexLayout(
+			const std::vector<VkVertexInputBindingDescription>& bindingDescriptions,
+			const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions);
+
+		// Creates the pipeline on the first request for a state, or waits for it if it is already
+		// compiling in the background. The last lookup is remembered, so runs of draws with the same
+		// state cost one comparison.
+		LivePipeline* getPipeline(const PipelineState& state);
+		// Never blocks: returns null and queues the state for background compilation if its pipeline
+		// isn't ready yet. The caller skips the draw or uses a fallback until a later frame.
+		LivePipeline* requestPipeline(const PipelineState& state);
+		// Compiles every state that isn't cached yet across the background threads, and waits for
+		// all of them. Meant for load time.
+		void warmUp(const std::vector<PipelineState>& states);
+		// Makes pipelines finished since the last call available. Call once per frame; rethrows the
+		// error of a failed compilation.
+		void collectCompiled();
+
+		size_t getPipelineCount() const { return pipelines.size() - pendingCount; }
+		size_t getPendingCount() const { return pendingCount; }
+
+	private:
+		struct Program {
+			std::string vertFilePath;
+			std::string fragFilePath;
+		};
+
+		struct VertexLayout {
+			std::vector<VkVertexInputBindingDescription>   bindingDescriptions;
+			std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		};
+
+		struct StateHash {
+			size_t operator()(const PipelineState& state) const;
+		};
+
+		struct Entry {
+			std::unique_ptr<LivePipeline> pipeline;
+			bool                          pending = false;  // queued or compiling
+		};
+
+		// Everything a worker needs, copied so registration can go on while it compiles
+		struct Job {
+			PipelineState state;
+			Program       program;
+			VertexLayout  vertexLayout;
+		};
+
+		struct CompiledPipeline {
+			PipelineState                 state;
+			std::unique_ptr<LivePipeline> pipeline;
+			std::exception_ptr            error;
+		};
+
+		Job makeJob(const PipelineState& state) const;
+		std::unique_ptr<LivePipeline> createPipeline(const Job& job) const;
+		void enqueue(const PipelineState& state, Entry& entry);
+		void waitForCompiled();
+		void workerLoop();
+
+		LiveDevice&                    liveDevice;
+		VkPipelineCache                driverCache = VK_NULL_HANDLE;
+		std::vector<Program>           programs{};
+		std::vector<VertexLayout>      vertexLayouts{};
+		std::unordered_map<PipelineState, Entry, StateHash> pipelines{};
+		size_t                         pendingCount = 0;
+
+		PipelineState                  lastState{};
+		LivePipeline*                  lastPipeline = nullptr;
+
+		// Shared with the workers, guarded by mutex
+		std::mutex                     mutex;
+		std::condition_variable        jobQueued;
+		std::condition_variable        jobCompiled;
+		std::deque<Job>                jobs{};
+		std::vector<CompiledPipeline>  compiled{};
+		bool                           stopping = false;
+		std::vector<std::thread>       workers{};
+	};
+}
@@ -0,0 +1,222 @@
+#include "queue_timeline.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+
+namespace live {
+	QueueTimeline::QueueTimeline(LiveDevice& device, VkQueue queue, bool useTimelineSemaphore) : device{ device }, queue{ queue } {
+		if (!useTimelineSemaphore) {
+			return;
+		}
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timeline semaphore.");
+		}
+	}
+
+	QueueTimeline::~QueueTimeline() {
+		wait(submittedValue);
+
+		for (auto fence : signaledFences) {
+			vkDestroyFence(device.device(), fence, nullptr);
+		}
+		for (auto fence : freeFences) {
+			vkDestroyFence(device.device(), fence, nullptr);
+		}
+
+		if (timelineSemaphore != VK_NULL_HANDLE) {
+			vkDestroySemaphore(device.device(), timelineSemaphore, nullptr);
+		}
+	}
+
+	uint64_t QueueTimeline::submit(const VkSubmitInfo& submitInfo, const std::vector<TimelineWait>& waits) {
+		if (!usesTimelineSemaphore()) {
+			// Without timeline semaphores cross-queue waits fall back to the host
+			for (const auto& waitInfo : waits) {
+				if (waitInfo.timeline != this) {
+					waitInfo.timeline->wait(waitInfo.value);
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		const uint64_t value = submittedValue + 1;
+		VkSubmitInfo info = submitInfo;
+
+		if (usesTimelineSemaphore()) {
+			std::vector<VkSemaphore> waitSemaphores(info.pWaitSemaphores, info.pWaitSemaphores + info.waitSemaphoreCount);
+			std::vector<VkPipelineStageFlags> waitStages(info.pWaitDstStageMask, info.pWaitDstStageMask + info.waitSemaphoreCount);
+			std::vector<uint64_t> waitValues(info.waitSemaphoreCount, 0);
+
+			for (const auto& waitInfo : waits) {
+				waitSemaphores.push_back(waitInfo.timeline->getSemaphore());
+				waitStages.push_back(waitInfo.stageMask);
+				waitValues.push_back(waitInfo.value);
+			}
+
+			std::vector<VkSemaphore> signalSemaphores(info.pSignalSemaphores, info.pSignalSemaphores + info.signalSemaphoreCount);
+			std::vector<uint64_t> signalValues(info.signalSemaphoreCount, 0);
+			signalSemaphores.push_back(timelineSemaphore);
+			signalValues.push_back(value);
+
+			VkTimelineSemaphoreSubmitInfo timelineInfo{};
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineInfo.pNext = info.pNext;
+			timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+			timelineInfo.pWaitSemaphoreValues = waitValues.data();
+			timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+			timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+			info.pNext = &timelineInfo;
+			info.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+			info.pWaitSemaphores = waitSemaphores.data();
+			info.pWaitDstStageMask = waitStages.data();
+			info.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+			info.pSignalSemaphores = signalSemaphores.data();
+
+			if (vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to submit to queue timeline.");
+			}
+		} else {
+			VkFence fence = acquireFence();
+
+			if (vkQueueSubmit(queue, 1, &info, fence) != VK_SUCCESS) {
+				freeFences.push_back(fence);
+				throw std::runtime_error("Failed to submit to queue timeline.");
+			}
+
+			pendingFences.emplace_back(value, fence);
+		}
+
+		submittedValue = value;
+		return value;
+	}
+
+	void QueueTimeline::wait(uint64_t value) {
+		{
+			// Nothing will ever signal a value that was not submitted, so waiting for one would hang
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (value > submittedValue) {
+				throw std::runtime_error("Waited on a queue timeline value that was never submitted.");
+			}
+		}
+
+		if (isComplete(value)) {
+			return;
+		}
+
+		if (usesTimelineSemaphore()) {
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &timelineSemaphore;
+			waitInfo.pValues = &value;
+
+			if (vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to wait on queue timeline.");
+			}
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			knownCompletedValue = std::max(knownCompletedValue, value);
+			return;
+		}
+
+		// A fence signals only after every earlier submission on the queue has completed, so waiting
+		// on the one for value is enough. The wait runs unlocked so other threads can keep submitting;
+		// fenceWaiters holds back resetting fences until it is done.
+		uint64_t fenceValue;
+		VkFence  fence;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			retireSignaledFences();
+			if (knownCompletedValue >= value || pendingFences.empty()) {
+				return;
+			}
+
+			auto pending = std::find_if(pendingFences.begin(), pendingFences.end(), [value](const auto& entry) { return entry.first >= value; });
+			fenceValue = pending->first;
+			fence = pending->second;
+			fenceWaiters++;
+		}
+
+		VkResult result = vkWaitForFences(device.device(), 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		fenceWaiters--;
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to wait on queue timeline.");
+		}
+		knownCompletedValue = std::max(knownCompletedValue, fenceValue);
+		retireSignaledFences();
+	}
+
+	uint64_t QueueTimeline::nextValue() {
+		std::lock_guard<std::mutex> lock{ mutex };
+		return submittedValue + 1;
+	}
+
+	uint64_t QueueTimeline::completedValue() {
+		if (usesTimelineSemaphore()) {
+			uint64_t value = 0;
+			if (vkGetSemaphoreCounterValue(device.device(), timelineSemaphore, &value) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to read queue timeline value.");
+			}
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			knownCompletedValue = std::max(knownCompletedValue, value);
+			return knownCompletedValue;
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		retireSignaledFences();
+		return knownCompletedValue;
+	}
+
+	VkFence QueueTimeline::acquireFence() {
+		retireSignaledFences();
+
+		if (!freeFences.empty()) {
+			VkFence fence = freeFences.back();
+			freeFences.pop_back();
+			return fence;
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		VkFence fence;
+		if (vkCreateFence(device.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create queue timeline fence.");
+		}
+
+		return fence;
+	}
+
+	void QueueTimeline::retireSignaledFences() {
+		while (!pendingFences.empty() && vkGetFenceStatus(device.device(), pendingFences.front().second) == VK_SUCCESS) {
+			signaledFences.push_back(pendingFences.front().second);
+			knownCompletedValue = std::max(knownCompletedValue, pendingFences.front().first);
+			pendingFences.pop_front();
+		}
+
+		// A reset fence could be reused and never signaled again under a waiter that is still blocked on it
+		if (fenceWaiters == 0 && !signaledFences.empty()) {
+			vkResetFences(device.device(), static_cast<uint32_t>(signaledFences.size()), signaledFences.data());
+			freeFences.insert(freeFences.end(), signaledFences.begin(), signaledFences.end());
+			signaledFences.clear();
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "engine_device.h"
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+namespace live {
+	class QueueTimeline;
+
+	struct TimelineWait {
+		QueueTimeline*       timeline;
+		uint64_t             value;
+		VkPipelineStageFlags stageMask;
+	};
+
+	// A monotonically increasing completion counter for one queue. Every submission made through the
+	// timeline signals the next value, so frames, uploads and readbacks can all wait on work by value
+	// instead of owning fences. Backed by a Vulkan 1.2 timeline semaphore when available, otherwise by
+	// one fence per outstanding submission.
+	class QueueTimeline {
+	public:
+		QueueTimeline(LiveDevice& device, VkQueue queue, bool useTimelineSemaphore);
+		~QueueTimeline();
+
+		QueueTimeline(const QueueTimeline&) = delete;
+		QueueTimeline& operator=(const QueueTimeline&) = delete;
+
+		// Submits one batch and returns the timeline value it signals on completion
+		uint64_t submit(const VkSubmitInfo& submitInfo, const std::vector<TimelineWait>& waits = {});
+
+		// Blocks until value completes; throws if value has not been submitted yet
+		void wait(uint64_t value);
+		bool isComplete(uint64_t value) { return value <= completedValue(); }
+		uint64_t completedValue();
+		// The value the next submission will signal, read under the lock submit takes
+		uint64_t nextValue();
+
+		bool usesTimelineSemaphore() const { return timelineSemaphore != VK_NULL_HANDLE; }
+		VkSemaphore getSemaphore() const { return timelineSemaphore; }
+
+	private:
+		VkFence acquireFence();
+		void retireSignaledFences();
+
+		LiveDevice&                              device;
+		VkQueue                                  queue;
+		VkSemaphore                              timelineSemaphore = VK_NULL_HANDLE;
+
+		std::mutex                               mutex;
+		uint64_t                                 submittedValue = 0;
+		uint64_t                                 knownCompletedValue = 0;
+
+		// Fallback when timeline semaphores are unsupported
+		std::deque<std::pair<uint64_t, VkFence>> pendingFences;
+		std::vector<VkFence>                     signaledFences;  // not reset yet, see retireSignaledFences
+		std::vector<VkFence>                     freeFences;
+		uint32_t                                 fenceWaiters = 0;  // wait calls blocked outside the lock
+	};
+}
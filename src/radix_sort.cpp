@@ -0,0 +1,187 @@
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+namespace {
+	constexpr unsigned RADIX_BITS = 8;
+	constexpr size_t   BUCKET_COUNT = size_t{ 1 } << RADIX_BITS;
+	constexpr unsigned PASS_COUNT = 64 / RADIX_BITS;
+
+	using Histogram = std::array<size_t, BUCKET_COUNT>;
+
+	size_t digit(uint64_t key, unsigned pass) {
+		return static_cast<size_t>(key >> (pass * RADIX_BITS)) & (BUCKET_COUNT - 1);
+	}
+
+	bool passNeeded(uint64_t varyingBits, unsigned pass) {
+		return digit(varyingBits, pass) != 0;
+	}
+
+	// Bits that differ from reference in at least one key
+	uint64_t varyingBits(const live::SortKey* keys, size_t count, uint64_t reference) {
+		uint64_t bits = 0;
+		for (size_t i = 0; i < count; i++) {
+			bits |= keys[i].key ^ reference;
+		}
+		return bits;
+	}
+
+	// Reusable rendezvous for the sort's worker threads; std::barrier is C++20
+	class Barrier {
+	public:
+		explicit Barrier(unsigned threadCount) : threadCount{ threadCount } {}
+
+		void wait() {
+			std::unique_lock<std::mutex> lock{ mutex };
+			unsigned arrivalGeneration = generation;
+			if (++arrived == threadCount) {
+				arrived = 0;
+				generation++;
+				condition.notify_all();
+				return;
+			}
+			condition.wait(lock, [&]() { return generation != arrivalGeneration; });
+		}
+
+	private:
+		std::mutex              mutex;
+		std::condition_variable condition;
+		unsigned                threadCount;
+		unsigned                arrived = 0;
+		unsigned                generation = 0;
+	};
+
+	void sortSerial(std::vector<live::SortKey>& keys, std::vector<live::SortKey>& scratch) {
+		size_t   count = keys.size();
+		uint64_t varying = varyingBits(keys.data(), count, keys[0].key);
+
+		for (unsigned pass = 0; pass < PASS_COUNT; pass++) {
+			if (!passNeeded(varying, pass)) {
+				continue;
+			}
+
+			Histogram offsets{};
+			for (size_t i = 0; i < count; i++) {
+				offsets[digit(keys[i].key, pass)]++;
+			}
+			size_t running = 0;
+			for (auto& offset : offsets) {
+				size_t bucketSize = offset;
+				offset = running;
+				running += bucketSize;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				scratch[offsets[digit(keys[i].key, pass)]++] = keys[i];
+			}
+			keys.swap(scratch);
+		}
+	}
+
+	// Every thread runs the same passes over its own slice with barriers between counting and
+	// scattering, so the slices land in order within each bucket and the sort stays stable.
+	void sortParallel(std::vector<live::SortKey>& keys, std::vector<live::SortKey>& scratch, unsigned threadCount) {
+		size_t   count = keys.size();
+		uint64_t reference = keys[0].key;
+
+		std::vector<Histogram> histograms(threadCount);
+		std::vector<uint64_t>  varying(threadCount);
+		Barrier                barrier{ threadCount };
+
+		live::SortKey* keysData = keys.data();
+		live::SortKey* scratchData = scratch.data();
+		live::SortKey* result = keysData;
+
+		auto work = [&](unsigned thread) {
+			size_t begin = count * thread / threadCount;
+			size_t end = count * (thread + 1) / threadCount;
+
+			varying[thread] = varyingBits(keysData + begin, end - begin, reference);
+			barrier.wait();
+
+			uint64_t allVarying = 0;
+			for (uint64_t bits : varying) {
+				allVarying |= bits;
+			}
+
+			live::SortKey* source = keysData;
+			live::SortKey* target = scratchData;
+			for (unsigned pass = 0; pass < PASS_COUNT; pass++) {
+				if (!passNeeded(allVarying, pass)) {
+					continue;
+				}
+
+				Histogram& histogram = histograms[thread];
+				histogram.fill(0);
+				for (size_t i = begin; i < end; i++) {
+					histogram[digit(source[i].key, pass)]++;
+				}
+				barrier.wait();
+
+				// This slice's part of each bucket starts after the whole of the smaller buckets and
+				// after the earlier slices' part of the same bucket
+				Histogram offsets;
+				size_t    running = 0;
+				for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+					for (unsigned other = 0; other < threadCount; other++) {
+						if (other == thread) {
+							offsets[bucket] = running;
+						}
+						running += histograms[other][bucket];
+					}
+				}
+
+				for (size_t i = begin; i < end; i++) {
+					target[offsets[digit(source[i].key, pass)]++] = source[i];
+				}
+				barrier.wait();
+
+				std::swap(source, target);
+			}
+
+			if (thread == 0) {
+				result = source;
+			}
+		};
+
+		std::vector<std::thread> workers{};
+		workers.reserve(threadCount - 1);
+		for (unsigned thread = 1; thread < threadCount; thread++) {
+			workers.emplace_back(work, thread);
+		}
+		work(0);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		if (result != keysData) {
+			keys.swap(scratch);
+		}
+	}
+}
+
+
+namespace live {
+	void radixSort(std::vector<SortKey>& keys, std::vector<SortKey>& scratch, unsigned threadCount) {
+		scratch.resize(keys.size());
+		if (keys.size() < 2) {
+			return;
+		}
+
+		if (threadCount == 0) {
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		size_t sliceCount = std::min<size_t>(threadCount, keys.size() / RADIX_SORT_MIN_KEYS_PER_THREAD);
+		if (sliceCount > 1) {
+			sortParallel(keys, scratch, static_cast<unsigned>(sliceCount));
+		} else {
+			sortSerial(keys, scratch);
+		}
+	}
+}
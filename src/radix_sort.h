@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace live {
+	// A 64-bit key and the index of the item it was built from
+	struct SortKey {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// Below this many keys per thread the sort stays on the calling thread
+	constexpr size_t RADIX_SORT_MIN_KEYS_PER_THREAD = 1 << 14;
+
+	// Stable LSD radix sort on the key, 8 bits per pass. Bytes that are equal in every key are
+	// skipped, so keys that leave fields empty only pay for the bytes in use. Large inputs are split
+	// across threads: each one counts its own slice and scatters it into its share of every bucket,
+	// which keeps the result identical to the single threaded sort.
+	//
+	// scratch is resized to match keys and may be swapped with it; keep both around between calls to
+	// reuse the allocations. threadCount 0 uses every hardware thread.
+	void radixSort(std::vector<SortKey>& keys, std::vector<SortKey>& scratch, unsigned threadCount = 0);
+}
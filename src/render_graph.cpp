@@ -0,0 +1,660 @@
+#include "render_graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+namespace live {
+	RenderGraph::~RenderGraph() {
+		releaseResources();
+	}
+
+	RenderGraph::ResourceId RenderGraph::PassBuilder::createImage(const std::string& name, const ImageDesc& desc) {
+		Resource resource{};
+		resource.name = name;
+		resource.desc = desc;
+		graph.resources.push_back(resource);
+		return static_cast<ResourceId>(graph.resources.size() - 1);
+	}
+
+	void RenderGraph::PassBuilder::writeColor(ResourceId image, VkClearColorValue clearValue) {
+		VkClearValue clear{};
+		clear.color = clearValue;
+		graph.use(pass, image, Access::ColorWrite, clear);
+	}
+
+	void RenderGraph::PassBuilder::writeDepth(ResourceId image, float clearDepth) {
+		VkClearValue clear{};
+		clear.depthStencil = { clearDepth, 0 };
+		graph.use(pass, image, Access::DepthWrite, clear);
+	}
+
+	void RenderGraph::PassBuilder::readDepth(ResourceId image) { graph.use(pass, image, Access::DepthRead); }
+
+	void RenderGraph::PassBuilder::readSampled(ResourceId image) { graph.use(pass, image, Access::Sampled); }
+
+	void RenderGraph::PassBuilder::readTransfer(ResourceId image) { graph.use(pass, image, Access::TransferSrc); }
+
+	void RenderGraph::PassBuilder::writeTransfer(ResourceId image) { graph.use(pass, image, Access::TransferDst); }
+
+	void RenderGraph::PassBuilder::setSideEffects() { graph.passes[pass].sideEffects = true; }
+
+	void RenderGraph::reset() {
+		releaseResources();
+		resources.clear();
+		passes.clear();
+		keptPasses.clear();
+		finalBarriers = {};
+	}
+
+	RenderGraph::ResourceId RenderGraph::importImage(const std::string& name, const ImageDesc& desc, VkImageLayout layout) {
+		assert(!compiled && "Cannot import images into a compiled render graph");
+
+		Resource resource{};
+		resource.name = name;
+		resource.desc = desc;
+		resource.imported = true;
+		resource.importedLayout = layout;
+		resources.push_back(resource);
+		return static_cast<ResourceId>(resources.size() - 1);
+	}
+
+	// Framebuffers are cached per set of views, so importing a handful of images in rotation (like
+	// swap chain images) creates each framebuffer once
+	void RenderGraph::setImportedImage(ResourceId image, VkImage handle, VkImageView view) {
+		assert(resources[image].imported && "Only imported images can be set");
+		resources[image].image = handle;
+		resources[image].view = view;
+	}
+
+	bool RenderGraph::sharesMemory(ResourceId a, ResourceId b) const {
+		return resources[a].memoryBlock != ~0u && resources[a].memoryBlock == resources[b].memoryBlock;
+	}
+
+	RenderGraph::PassId RenderGraph::addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute) {
+		assert(!compiled && "Cannot add passes to a compiled render graph");
+
+		Pass pass{};
+		pass.name = name;
+		pass.execute = std::move(execute);
+		passes.push_back(std::move(pass));
+
+		PassId id = static_cast<PassId>(passes.size() - 1);
+		PassBuilder builder{ *this, id };
+		setup(builder);
+		return id;
+	}
+
+	void RenderGraph::use(PassId pass, ResourceId resource, Access access, VkClearValue clearValue) {
+		assert(resource < resources.size() && "Unknown render graph resource");
+
+		std::vector<Use>& uses = passes[pass].uses;
+		assert(std::none_of(uses.begin(), uses.end(), [&](const Use& other) { return other.resource == resource; }) &&
+			"A pass can use each image only once");
+		uses.push_back({ resource, access, clearValue });
+	}
+
+	void RenderGraph::compile() {
+		releaseResources();
+
+		cullPasses();
+		computeLifetimes();
+		allocateTransients();
+		planBarriers();
+		createRenderPasses();
+		compiled = true;
+	}
+
+	// Walks the passes backwards keeping every pass whose writes reach a kept pass, an imported
+	// image or a side effect. Writes count as reads too: only an image's first write clears it, so
+	// later writes build on the earlier ones.
+	void RenderGraph::cullPasses() {
+		std::vector<bool> needed(resources.size(), false);
+		for (size_t i = passes.size(); i-- > 0;) {
+			Pass& pass = passes[i];
+
+			bool kept = pass.sideEffects;
+			for (const auto& use : pass.uses) {
+				if (accessState(use.access).write && (resources[use.resource].imported || needed[use.resource])) {
+					kept = true;
+				}
+			}
+
+			pass.culled = !kept;
+			if (kept) {
+				for (const auto& use : pass.uses) {
+					needed[use.resource] = true;
+				}
+			}
+		}
+
+		keptPasses.clear();
+		for (PassId i = 0; i < passes.size(); i++) {
+			if (!passes[i].culled) {
+				keptPasses.push_back(i);
+			}
+		}
+	}
+
+	// First and last use in kept-pass order, usage flags, and the state each image is left in at the
+	// end of the graph, which is what the next frame's first use waits on. Consecutive reads in the
+	// same layout accumulate, like in planBarriers.
+	void RenderGraph::computeLifetimes() {
+		for (auto& resource : resources) {
+			resource.firstUse = ~0u;
+			resource.lastUse = 0;
+			resource.usage = 0;
+			resource.lazy = false;
+			resource.lastState = {};
+		}
+
+		for (uint32_t position = 0; position < keptPasses.size(); position++) {
+			for (const auto& use : passes[keptPasses[position]].uses) {
+				Resource&   resource = resources[use.resource];
+				AccessState state = accessState(use.access);
+
+				if (resource.firstUse == ~0u) {
+					assert((resource.imported || state.write) && "Transient image is read before it is written");
+					resource.firstUse = position;
+				}
+				resource.lastUse = position;
+				resource.usage |= accessUsage(use.access);
+
+				AccessState& last = resource.lastState;
+				if (!last.write && !state.write && last.layout == state.layout) {
+					last.stages |= state.stages;
+					last.access |= state.access;
+				} else {
+					last = state;
+				}
+			}
+		}
+	}
+
+	// Creates the transient images and packs them into as few memory blocks as possible: largest
+	// first, each into the first block whose occupants are all dead before it is first used or born
+	// after it is last used.
+	//
+	// Images used only as attachments of a single pass are cleared on load and discarded on store,
+	// so where the device has lazily allocated memory they become transient attachments in it; tiled
+	// GPUs then keep them in tile memory without committing any. They are packed among themselves.
+	void RenderGraph::allocateTransients() {
+		VkDevice device = liveDevice.device();
+		bool     lazyMemory = liveDevice.supportsMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+		const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		std::vector<ResourceId>           transients{};
+		std::vector<VkMemoryRequirements> requirements(resources.size());
+		for (ResourceId id = 0; id < resources.size(); id++) {
+			Resource& resource = resources[id];
+			if (resource.imported || resource.firstUse == ~0u) {
+				continue;
+			}
+
+			resource.lazy = lazyMemory && resource.firstUse == resource.lastUse && (resource.usage & ~attachmentUsage) == 0;
+			if (resource.lazy) {
+				resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			}
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = resource.desc.format;
+			imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = resource.usage;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create render graph image " + resource.name + ".");
+			}
+			vkGetImageMemoryRequirements(device, resource.image, &requirements[id]);
+			unaliasedMemory += requirements[id].size;
+			transients.push_back(id);
+		}
+
+		std::stable_sort(transients.begin(), transients.end(), [&](ResourceId a, ResourceId b) {
+			return requirements[a].size > requirements[b].size;
+		});
+
+		auto overlaps = [&](ResourceId a, ResourceId b) {
+			return resources[a].firstUse <= resources[b].lastUse && resources[b].firstUse <= resources[a].lastUse;
+		};
+
+		for (ResourceId id : transients) {
+			const VkMemoryRequirements& imageRequirements = requirements[id];
+
+			auto block = std::find_if(memoryBlocks.begin(), memoryBlocks.end(), [&](const MemoryBlock& candidate) {
+				return candidate.lazy == resources[id].lazy &&
+					(candidate.memoryTypeBits & imageRequirements.memoryTypeBits) != 0 &&
+					std::none_of(candidate.occupants.begin(), candidate.occupants.end(), [&](ResourceId other) { return overlaps(id, other); });
+			});
+			if (block == memoryBlocks.end()) {
+				block = memoryBlocks.insert(memoryBlocks.end(), MemoryBlock{});
+				block->lazy = resources[id].lazy;
+			}
+
+			block->size = std::max(block->size, imageRequirements.size);
+			block->memoryTypeBits &= imageRequirements.memoryTypeBits;
+			block->occupants.push_back(id);
+			resources[id].memoryBlock = static_cast<uint32_t>(block - memoryBlocks.begin());
+		}
+
+		for (auto& block : memoryBlocks) {
+			std::sort(block.occupants.begin(), block.occupants.end(), [&](ResourceId a, ResourceId b) {
+				return resources[a].firstUse < resources[b].firstUse;
+			});
+
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = block.size;
+			allocInfo.memoryTypeIndex = liveDevice.findMemoryType(
+				block.memoryTypeBits,
+				block.lazy ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			liveDevice.allocateMemory(allocInfo, block.memory);
+			transientMemory += block.size;
+
+			for (ResourceId id : block.occupants) {
+				Resource& resource = resources[id];
+				if (vkBindImageMemory(device, resource.image, block.memory, 0) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to bind render graph image memory.");
+				}
+
+				VkImageViewCreateInfo viewInfo{};
+				viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewInfo.image = resource.image;
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = resource.desc.format;
+				viewInfo.subresourceRange = { aspectMask(resource.desc.format), 0, 1, 0, 1 };
+
+				if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to create render graph image view " + resource.name + ".");
+				}
+			}
+		}
+	}
+
+	// Tracks every image's state through the kept passes and inserts a barrier wherever the layout
+	// changes or a write is involved. A transient image starts each frame undefined, after the
+	// last use of the image that held its memory before it; with no other occupant, that is its own
+	// last use in the previous frame.
+	void RenderGraph::planBarriers() {
+		std::vector<AccessState> states(resources.size());
+		for (ResourceId id = 0; id < resources.size(); id++) {
+			const Resource& resource = resources[id];
+			if (resource.imported) {
+				states[id] = { resource.importedLayout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT, true };
+			} else if (resource.memoryBlock != ~0u) {
+				const auto& occupants = memoryBlocks[resource.memoryBlock].occupants;
+				auto        self = std::find(occupants.begin(), occupants.end(), id);
+				ResourceId  previous = self == occupants.begin() ? occupants.back() : *(self - 1);
+
+				states[id] = resources[previous].lastState;
+				states[id].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+
+		for (PassId id : keptPasses) {
+			Pass& pass = passes[id];
+			pass.barriers = {};
+			for (const auto& use : pass.uses) {
+				addBarrier(pass.barriers, use.resource, states[use.resource], accessState(use.access));
+			}
+		}
+
+		finalBarriers = {};
+		for (ResourceId id = 0; id < resources.size(); id++) {
+			const Resource& resource = resources[id];
+			if (resource.imported && resource.firstUse != ~0u) {
+				AccessState returned{ resource.importedLayout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, true };
+				addBarrier(finalBarriers, id, states[id], returned);
+			}
+		}
+	}
+
+	void RenderGraph::addBarrier(BarrierBatch& batch, ResourceId resource, AccessState& current, const AccessState& next) {
+		if (!current.write && !next.write && current.layout == next.layout) {
+			current.stages |= next.stages;
+			current.access |= next.access;
+			return;
+		}
+
+		// Reads only need the execution dependency
+		batch.barriers.push_back({ resource, current.layout, next.layout, current.write ? current.access : VkAccessFlags{ 0 }, next.access });
+		batch.srcStages |= current.stages;
+		batch.dstStages |= next.stages;
+		current = next;
+	}
+
+	// One single-subpass render pass per pass with attachments. The barriers before the pass do the
+	// layout transitions, so attachments start and end in the layout they are used in. An image's
+	// first use clears it and its contents are only stored if a later pass or the importer needs them.
+	void RenderGraph::createRenderPasses() {
+		for (uint32_t position = 0; position < keptPasses.size(); position++) {
+			Pass& pass = passes[keptPasses[position]];
+
+			std::vector<VkAttachmentDescription> attachments{};
+			std::vector<VkAttachmentReference>   colorReferences{};
+			VkAttachmentReference                depthReference{};
+			bool                                 hasDepth = false;
+
+			pass.attachments.clear();
+			pass.clearValues.clear();
+			for (const auto& use : pass.uses) {
+				if (!isAttachment(use.access)) {
+					continue;
+				}
+
+				const Resource& resource = resources[use.resource];
+				assert((pass.attachments.empty() ||
+					(resource.desc.extent.width == pass.extent.width && resource.desc.extent.height == pass.extent.height)) &&
+					"Attachments of a pass must have the same extent");
+				pass.extent = resource.desc.extent;
+
+				bool          contentsUndefined = resource.firstUse == position && (!resource.imported || resource.importedLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+				bool          contentsNeeded = resource.imported || resource.lastUse > position;
+				VkImageLayout layout = accessState(use.access).layout;
+
+				VkAttachmentDescription attachment{};
+				attachment.format = resource.desc.format;
+				attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+				attachment.loadOp = contentsUndefined ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+				attachment.storeOp = contentsNeeded ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachment.initialLayout = layout;
+				attachment.finalLayout = layout;
+
+				VkAttachmentReference reference{ static_cast<uint32_t>(attachments.size()), layout };
+				if (use.access == Access::ColorWrite) {
+					colorReferences.push_back(reference);
+				} else {
+					assert(!hasDepth && "A pass can have only one depth attachment");
+					depthReference = reference;
+					hasDepth = true;
+				}
+
+				attachments.push_back(attachment);
+				pass.attachments.push_back(use.resource);
+				pass.clearValues.push_back(use.clearValue);
+			}
+
+			if (attachments.empty()) {
+				continue;
+			}
+
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+			subpass.pColorAttachments = colorReferences.data();
+			subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+			VkRenderPassCreateInfo renderPassInfo{};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+			renderPassInfo.pAttachments = attachments.data();
+			renderPassInfo.subpassCount = 1;
+			renderPassInfo.pSubpasses = &subpass;
+
+			if (vkCreateRenderPass(liveDevice.device(), &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create render pass for " + pass.name + ".");
+			}
+		}
+	}
+
+	VkFramebuffer RenderGraph::getFramebuffer(Pass& pass) {
+		std::vector<VkImageView> views{};
+		views.reserve(pass.attachments.size());
+		for (ResourceId id : pass.attachments) {
+			assert(resources[id].view != VK_NULL_HANDLE && "Imported image was not set before execute");
+			views.push_back(resources[id].view);
+		}
+
+		auto found = pass.framebuffers.find(views);
+		if (found != pass.framebuffers.end()) {
+			return found->second;
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = pass.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+		framebufferInfo.pAttachments = views.data();
+		framebufferInfo.width = pass.extent.width;
+		framebufferInfo.height = pass.extent.height;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+		if (vkCreateFramebuffer(liveDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create framebuffer for " + pass.name + ".");
+		}
+		pass.framebuffers.emplace(std::move(views), framebuffer);
+		return framebuffer;
+	}
+
+	void RenderGraph::execute(FrameInfo& frameInfo) {
+		assert(compiled && "Render graph must be compiled before it is executed");
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		for (PassId id : keptPasses) {
+			Pass& pass = passes[id];
+			recordBarriers(commandBuffer, pass.barriers);
+
+			if (pass.renderPass != VK_NULL_HANDLE) {
+				VkRenderPassBeginInfo renderPassInfo{};
+				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassInfo.renderPass = pass.renderPass;
+				renderPassInfo.framebuffer = getFramebuffer(pass);
+				renderPassInfo.renderArea.offset = { 0, 0 };
+				renderPassInfo.renderArea.extent = pass.extent;
+				renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+				renderPassInfo.pClearValues = pass.clearValues.data();
+
+				vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+				VkViewport viewport{};
+				viewport.x = 0.0f;
+				viewport.y = 0.0f;
+				viewport.width = static_cast<float>(pass.extent.width);
+				viewport.height = static_cast<float>(pass.extent.height);
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+				VkRect2D scissor{ {0, 0}, pass.extent };
+				vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			}
+
+			PassContext context{ frameInfo, pass.renderPass, pass.extent };
+			pass.execute(context);
+
+			if (pass.renderPass != VK_NULL_HANDLE) {
+				vkCmdEndRenderPass(commandBuffer);
+			}
+		}
+
+		recordBarriers(commandBuffer, finalBarriers);
+	}
+
+	void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) {
+		if (batch.barriers.empty()) {
+			return;
+		}
+
+		std::vector<VkImageMemoryBarrier> imageBarriers(batch.barriers.size());
+		for (size_t i = 0; i < batch.barriers.size(); i++) {
+			const ImageBarrier& planned = batch.barriers[i];
+			const Resource&     resource = resources[planned.resource];
+			assert(resource.image != VK_NULL_HANDLE && "Imported image was not set before execute");
+
+			VkImageMemoryBarrier& barrier = imageBarriers[i];
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = planned.srcAccess;
+			barrier.dstAccessMask = planned.dstAccess;
+			barrier.oldLayout = planned.oldLayout;
+			barrier.newLayout = planned.newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange = { aspectMask(resource.desc.format), 0, 1, 0, 1 };
+		}
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			batch.srcStages,
+			batch.dstStages,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			static_cast<uint32_t>(imageBarriers.size()),
+			imageBarriers.data());
+	}
+
+	// Everything compile created, destroyed once the frames recorded with it have completed
+	void RenderGraph::releaseResources() {
+		std::vector<VkImage>        images{};
+		std::vector<VkImageView>    views{};
+		std::vector<VkFramebuffer>  framebuffers{};
+		std::vector<VkRenderPass>   renderPasses{};
+		std::vector<VkDeviceMemory> memories{};
+
+		for (auto& resource : resources) {
+			if (resource.imported) {
+				continue;
+			}
+			if (resource.view != VK_NULL_HANDLE) {
+				views.push_back(resource.view);
+			}
+			if (resource.image != VK_NULL_HANDLE) {
+				images.push_back(resource.image);
+			}
+			resource.image = VK_NULL_HANDLE;
+			resource.view = VK_NULL_HANDLE;
+			resource.memoryBlock = ~0u;
+		}
+		for (auto& pass : passes) {
+			for (const auto& entry : pass.framebuffers) {
+				framebuffers.push_back(entry.second);
+			}
+			pass.framebuffers.clear();
+			if (pass.renderPass != VK_NULL_HANDLE) {
+				renderPasses.push_back(pass.renderPass);
+			}
+			pass.renderPass = VK_NULL_HANDLE;
+		}
+		for (const auto& block : memoryBlocks) {
+			memories.push_back(block.memory);
+		}
+		memoryBlocks.clear();
+		transientMemory = 0;
+		unaliasedMemory = 0;
+		compiled = false;
+
+		if (images.empty() && framebuffers.empty() && renderPasses.empty() && memories.empty()) {
+			return;
+		}
+
+		for (VkDeviceMemory memory : memories) {
+			liveDevice.retireMemory(memory);
+		}
+
+		VkDevice device = liveDevice.device();
+		liveDevice.deferDestruction([&owner = liveDevice, device, images, views, framebuffers, renderPasses, memories]() {
+			for (VkFramebuffer framebuffer : framebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+			for (VkImageView view : views) {
+				vkDestroyImageView(device, view, nullptr);
+			}
+			for (VkImage image : images) {
+				vkDestroyImage(device, image, nullptr);
+			}
+			for (VkRenderPass renderPass : renderPasses) {
+				vkDestroyRenderPass(device, renderPass, nullptr);
+			}
+			for (VkDeviceMemory memory : memories) {
+				owner.freeMemory(memory);
+			}
+		});
+	}
+
+	RenderGraph::AccessState RenderGraph::accessState(Access access) {
+		switch (access) {
+		case Access::ColorWrite:
+			return {
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				true };
+		case Access::DepthWrite:
+			return {
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				true };
+		case Access::DepthRead:
+			return {
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				false };
+		case Access::Sampled:
+			return {
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				false };
+		case Access::TransferSrc:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, false };
+		case Access::TransferDst:
+			return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, true };
+		}
+		throw std::runtime_error("Unknown render graph access.");
+	}
+
+	VkImageUsageFlags RenderGraph::accessUsage(Access access) {
+		switch (access) {
+		case Access::ColorWrite:
+			return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case Access::DepthWrite:
+		case Access::DepthRead:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case Access::Sampled:
+			return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case Access::TransferSrc:
+			return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case Access::TransferDst:
+			return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		}
+		return 0;
+	}
+
+	bool RenderGraph::isAttachment(Access access) {
+		return access == Access::ColorWrite || access == Access::DepthWrite || access == Access::DepthRead;
+	}
+
+	VkImageAspectFlags RenderGraph::aspectMask(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		case VK_FORMAT_S8_UINT:
+			return VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "engine_device.h"
+#include "frame_info.h"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace live {
+	// The frame as a list of passes that declare which images they read and write. compile() works
+	// out everything recording needs once per configuration: passes whose output nobody uses are
+	// culled, the barriers and layout transitions between passes are planned, transient images whose
+	// lifetimes don't overlap are placed in the same memory, and passes with attachments get a render
+	// pass. execute() then only records.
+	//
+	// Passes run in the order they were added. A pass is kept if it has side effects, writes an
+	// imported image, or writes an image that a kept pass reads.
+	class RenderGraph {
+	public:
+		using ResourceId = uint32_t;
+		using PassId = uint32_t;
+
+		struct ImageDesc {
+			VkFormat   format;
+			VkExtent2D extent;
+		};
+
+		// One image's transition or hazard, as planned by compile
+		struct ImageBarrier {
+			ResourceId    resource;
+			VkImageLayout oldLayout;
+			VkImageLayout newLayout;
+			VkAccessFlags srcAccess;
+			VkAccessFlags dstAccess;
+		};
+
+		// Declares a pass's images. Each image is used at most once per pass; attachments are bound
+		// in the order they are declared.
+		class PassBuilder {
+		public:
+			// Image owned by the graph whose contents don't outlive the frame. Its usage flags are
+			// derived from the passes that use it.
+			ResourceId createImage(const std::string& name, const ImageDesc& desc);
+
+			// The first write of a transient image clears it
+			void writeColor(ResourceId image, VkClearColorValue clearValue = {});
+			void writeDepth(ResourceId image, float clearDepth = 1.0f);
+			// Depth attachment tested against without writes
+			void readDepth(ResourceId image);
+			// Sampled in the fragment shader
+			void readSampled(ResourceId image);
+			void readTransfer(ResourceId image);
+			void writeTransfer(ResourceId image);
+			// Keeps the pass even if nothing reads what it writes, e.g. uploads or the pass presenting
+			void setSideEffects();
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& graph, PassId pass) : graph{ graph }, pass{ pass } {}
+
+			RenderGraph& graph;
+			PassId       pass;
+		};
+
+		// What a pass records with. Passes with attachments are recorded inside their render pass,
+		// with the viewport and scissor covering extent.
+		struct PassContext {
+			FrameInfo&   frameInfo;
+			VkRenderPass renderPass;  // VK_NULL_HANDLE for passes without attachments
+			VkExtent2D   extent;
+		};
+
+		using SetupFunction = std::function<void(PassBuilder&)>;
+		using ExecuteFunction = std::function<void(PassContext&)>;
+
+		explicit RenderGraph(LiveDevice& device) : liveDevice{ device } {}
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		// Starts a new configuration. The previous one's images and render passes are released once
+		// the frames using them have completed.
+		void reset();
+
+		// Image the graph doesn't own, e.g. a swap chain image. It is in layout when the graph starts
+		// and is returned to it at the end. Set the image to use before every execute.
+		ResourceId importImage(const std::string& name, const ImageDesc& desc, VkImageLayout layout);
+		void setImportedImage(ResourceId image, VkImage handle, VkImageView view);
+
+		PassId addPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+		void compile();
+		// Records every kept pass with the barriers planned in compile
+		void execute(FrameInfo& frameInfo);
+
+		bool isCompiled() const { return compiled; }
+		bool isPassCulled(PassId pass) const { return passes[pass].culled; }
+		// Valid after compile; pipelines for the pass are created against it
+		VkRenderPass getRenderPass(PassId pass) const { return passes[pass].renderPass; }
+		VkImageView getImageView(ResourceId image) const { return resources[image].view; }
+		// Valid after compile; barriers recorded before the pass, and after the last pass
+		const std::vector<ImageBarrier>& getBarriers(PassId pass) const { return passes[pass].barriers.barriers; }
+		const std::vector<ImageBarrier>& getFinalBarriers() const { return finalBarriers.barriers; }
+		// Whether compile placed two transient images in the same memory
+		bool sharesMemory(ResourceId a, ResourceId b) const;
+
+		// Device memory of the transient images as placed, and what it would be without aliasing.
+		// Lazily allocated memory counts at its full size, though tiled GPUs may never commit it.
+		VkDeviceSize getTransientMemory() const { return transientMemory; }
+		VkDeviceSize getUnaliasedMemory() const { return unaliasedMemory; }
+
+	private:
+		enum class Access {
+			ColorWrite,
+			DepthWrite,
+			DepthRead,
+			Sampled,
+			TransferSrc,
+			TransferDst
+		};
+
+		struct AccessState {
+			VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags        access = 0;
+			bool                 write = false;
+		};
+
+		struct Use {
+			ResourceId   resource;
+			Access       access;
+			VkClearValue clearValue;
+		};
+
+		struct Resource {
+			std::string          name;
+			ImageDesc            desc;
+			bool                 imported = false;
+			VkImageLayout        importedLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImage              image = VK_NULL_HANDLE;
+			VkImageView          view = VK_NULL_HANDLE;
+			VkImageUsageFlags    usage = 0;
+			bool                 lazy = false;  // transient attachment in lazily allocated memory
+			uint32_t             firstUse = ~0u;  // positions in the order of kept passes
+			uint32_t             lastUse = 0;
+			uint32_t             memoryBlock = ~0u;
+			AccessState          lastState{};  // its last access in the graph, for the next frame's first
+		};
+
+		// Barriers recorded together in one vkCmdPipelineBarrier
+		struct BarrierBatch {
+			std::vector<ImageBarrier> barriers{};
+			VkPipelineStageFlags      srcStages = 0;
+			VkPipelineStageFlags      dstStages = 0;
+		};
+
+		struct Pass {
+			std::string                     name;
+			std::vector<Use>                uses{};
+			ExecuteFunction                 execute;
+			bool                            sideEffects = false;
+			bool                            culled = false;
+			BarrierBatch                    barriers{};
+			VkRenderPass                    renderPass = VK_NULL_HANDLE;
+			VkExtent2D                      extent{};
+			std::vector<ResourceId>         attachments{};
+			std::vector<VkClearValue>       clearValues{};
+			std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers{};
+		};
+
+		// Memory shared by transient images with disjoint lifetimes
+		struct MemoryBlock {
+			VkDeviceMemory          memory = VK_NULL_HANDLE;
+			VkDeviceSize            size = 0;
+			uint32_t                memoryTypeBits = ~0u;
+			bool                    lazy = false;  // lazily allocated, for transient attachments
+			std::vector<ResourceId> occupants{};  // in order of first use
+		};
+
+		static AccessState accessState(Access access);
+		static VkImageUsageFlags accessUsage(Access access);
+		static bool isAttachment(Access access);
+		static VkImageAspectFlags aspectMask(VkFormat format);
+
+		void use(PassId pass, ResourceId resource, Access access, VkClearValue clearValue = {});
+		void cullPasses();
+		void computeLifetimes();
+		void allocateTransients();
+		void planBarriers();
+		void addBarrier(BarrierBatch& batch, ResourceId resource, AccessState& current, const AccessState& next);
+		void createRenderPasses();
+		VkFramebuffer getFramebuffer(Pass& pass);
+		void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+		void releaseResources();
+
+		LiveDevice&                    liveDevice;
+		std::vector<Resource>          resources{};
+		std::vector<Pass>              passes{};
+		std::vector<PassId>            keptPasses{};  // execution order
+		std::vector<MemoryBlock>       memoryBlocks{};
+		BarrierBatch                   finalBarriers{};  // returns imported images to their layout
+		bool                           compiled = false;
+		VkDeviceSize                   transientMemory = 0;
+		VkDeviceSize                   unaliasedMemory = 0;
+	};
+}
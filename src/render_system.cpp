@@ -5,78 +5,390 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 
 namespace live {
 
+	// Projection-view and lighting come from the global uniform buffer; the normal matrix is derived
+	// from the model matrix in the vertex shader.
 	struct SimplePushConstantData {
-		glm::mat4 transform{ 1.0f };
-		glm::mat4 normalMatrix { 1.0f };
+		glm::mat4 modelMatrix{ 1.0f };
 	};
 
-	RenderSystem::RenderSystem(LiveDevice& device, VkRenderPass renderPass) : device{ device } {
-		createPipelineLayout();
-		createPipeline(renderPass);
+	// LOD simplification error allowed on screen, as a fraction of the viewport height (~1px at 1080p)
+	static constexpr float LOD_ERROR_THRESHOLD = 1.0f / 1080.0f;
+
+	// Draw sort key fields, most significant first: pipeline (4 bits), material (16), model (20) and
+	// view depth (24), so state changes are grouped and every run of equal state goes front to back
+	// for early-Z.
+	static constexpr unsigned SORT_PIPELINE_SHIFT = 60;
+	static constexpr unsigned SORT_MATERIAL_SHIFT = 44;
+	static constexpr unsigned SORT_MODEL_SHIFT = 24;
+
+	static uint64_t makeSortKey(uint32_t pipeline, uint32_t material, uint32_t model, float viewDepth) {
+		assert(pipeline < (1u << 4) && material < (1u << 16) && model < (1u << 20) && "Draw sort key field overflow");
+
+		// Non-negative floats order like their bit patterns. The top 24 of the 31 value bits keep
+		// the exponent and 16 mantissa bits, so depth precision is relative to the distance.
+		float    depth = std::max(viewDepth, 0.0f);
+		uint32_t depthBits;
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+		return static_cast<uint64_t>(pipeline) << SORT_PIPELINE_SHIFT |
+			static_cast<uint64_t>(material) << SORT_MATERIAL_SHIFT |
+			static_cast<uint64_t>(model) << SORT_MODEL_SHIFT |
+			depthBits >> 7;
+	}
+
+	RenderSystem::RenderSystem(
+		LiveDevice& device,
+		VkRenderPass renderPass,
+		VkFormat colorFormat,
+		VkFormat depthFormat,
+		VkDescriptorSetLayout globalSetLayout,
+		PipelineCache& pipelineCache,
+		BindlessDescriptors* bindlessDescriptors,
+		const MaterialLibrary* materialLibrary)
+		: device{ device }, pipelineCache{ pipelineCache }, bindless{ bindlessDescriptors }, materials{ materialLibrary } {
+		createPipelineLayout(globalSetLayout);
+		createPipelineStates(renderPass, colorFormat, depthFormat);
 	}
 
 	RenderSystem::~RenderSystem() { vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr); }
 
-	void RenderSystem::createPipelineLayout() {
+	void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
 		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		pushConstantRange.offset = 0;
 		pushConstantRange.size = sizeof(SimplePushConstantData);
 
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+		if (bindless != nullptr) {
+			descriptorSetLayouts.push_back(bindless->getObjectSetLayout());
+			descriptorSetLayouts.push_back(bindless->getTextureSetLayout());
+		}
+
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 0;
-		pipelineLayoutInfo.pSetLayouts = nullptr;
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = bindless != nullptr ? 0 : 1;
+		pipelineLayoutInfo.pPushConstantRanges = bindless != nullptr ? nullptr : &pushConstantRange;
 
 		if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create pipeline layout.");
 		}
 	}
 
-	void RenderSystem::createPipeline(VkRenderPass renderPass) {
+	// Three states per vertex format: the color pass on its own, the color pass behind a depth
+	// pre-pass, and the pre-pass itself. All six pipelines are compiled up front, in parallel, so
+	// neither mode has to skip draws while they compile.
+	//
+	// With dynamic rendering the pre-pass shares one rendering scope with the color pass, the way the
+	// subpasses share one render pass, so the depth pipeline keeps the color attachment and writes
+	// nothing to it. Draws in a scope are depth tested in submission order, so no barrier is needed.
+	void RenderSystem::createPipelineStates(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat) {
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout.");
 
-		PipelineConfigInfo pipelineConfig{};
-		LivePipeline::defaultPipelineConfigInfo(pipelineConfig);
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
+		std::string shaderName = bindless != nullptr ? "shaders/bindless_shader" : "shaders/simple_shader";
+		colorPrograms[static_cast<size_t>(VertexFormat::Full)] = pipelineCache.registerProgram(shaderName + ".vert.spv", shaderName + ".frag.spv");
+		colorPrograms[static_cast<size_t>(VertexFormat::Packed)] = pipelineCache.registerProgram(shaderName + "_packed.vert.spv", shaderName + ".frag.spv");
+		vertexLayouts[static_cast<size_t>(VertexFormat::Full)] = pipelineCache.registerVertexLayout(
+			Model::Vertex::getBindingDescriptions(),
+			Model::Vertex::getAttributeDescriptions());
+		vertexLayouts[static_cast<size_t>(VertexFormat::Packed)] = pipelineCache.registerVertexLayout(
+			Model::PackedVertex::getBindingDescriptions(),
+			Model::PackedVertex::getAttributeDescriptions());
+
+		for (size_t format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+			VertexFormat vertexFormat = static_cast<VertexFormat>(format);
+			depthPrograms[format] = pipelineCache.registerProgram(shaderName + "_depth.vert.spv", "");
+			positionLayouts[format] = pipelineCache.registerVertexLayout(
+				Model::getPositionBindingDescriptions(vertexFormat),
+				Model::getPositionAttributeDescriptions(vertexFormat));
+		}
+
+		colorState.pipelineLayout = pipelineLayout;
+		colorState.renderPass = renderPass;
+		if (renderPass != VK_NULL_HANDLE) {
+			colorState.subpass = LiveSwapChain::COLOR_SUBPASS;
+		} else {
+			colorState.colorFormat = colorFormat;
+			colorState.depthFormat = depthFormat;
+		}
+		// OBJ faces wind counter-clockwise seen from outside, and neither the camera nor the object
+		// transforms mirror, so they stay counter-clockwise in the framebuffer. Culling back faces in
+		// the pipeline is also what makes the cluster culler's normal cone test valid.
+		colorState.cullMode = VK_CULL_MODE_BACK_BIT;
+		colorState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		clusterCuller.setBackfaceCulling((colorState.cullMode & VK_CULL_MODE_BACK_BIT) != 0);
+
+		// The pre-pass already holds the nearest depth of every pixel, so only the surface that
+		// wrote it passes. Depth matches bit for bit because the shaders mark gl_Position invariant.
+		prepassColorState = colorState;
+		prepassColorState.depthWrite = VK_FALSE;
+		prepassColorState.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+		depthState = colorState;
+		if (renderPass != VK_NULL_HANDLE) {
+			depthState.subpass = LiveSwapChain::DEPTH_PREPASS_SUBPASS;
+			depthState.colorAttachmentCount = 0;
+		}
+
+		std::vector<PipelineState> states{};
+		for (size_t format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+			for (PipelineState state : { colorState, prepassColorState }) {
+				state.program = colorPrograms[format];
+				state.vertexLayout = vertexLayouts[format];
+				states.push_back(state);
+			}
 
-		livePipeline = std::make_unique<LivePipeline>(device, "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv", pipelineConfig);
+			PipelineState state = depthState;
+			state.program = depthPrograms[format];
+			state.vertexLayout = positionLayouts[format];
+			states.push_back(state);
+		}
+		pipelineCache.warmUp(states);
+	}
+
+	// Full-detail submeshes with meshlets are drawn from the commands the cluster culler left in the
+	// frame allocator; everything else is drawn directly. Without drawIndirectFirstInstance the
+	// commands' firstInstance must be 0, so bindless draws replay them directly instead.
+	void RenderSystem::drawModel(FrameInfo& frameInfo, const DrawItem& draw, uint32_t firstInstance) {
+		if (!draw.clustered) {
+			draw.model->drawSubmesh(frameInfo.commandBuffer, draw.submesh, firstInstance, draw.lod);
+			return;
+		}
+
+		if (firstInstance == 0 || device.enabledFeatures.drawIndirectFirstInstance) {
+			if (draw.commandCount > 0) {
+				draw.model->drawIndirect(frameInfo.commandBuffer, frameInfo.frameAllocator.getBuffer(), draw.commandOffset, draw.commandCount);
+			}
+			return;
+		}
+
+		for (uint32_t i = 0; i < draw.commandCount; i++) {
+			const VkDrawIndexedIndirectCommand& command = draw.commands[i];
+			vkCmdDrawIndexed(frameInfo.commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+		}
 	}
 
-	void RenderSystem::renderObjects(FrameInfo& frameInfo, std::vector<Object>& objects) {
-		livePipeline->bind(frameInfo.commandBuffer);
+	// Expands the objects into one draw per submesh and sorts them across the whole scene by their
+	// sort keys, so state changes and vertex/index rebinds happen once per run instead of once per
+	// object. Models are numbered in order of first use each frame to fit the key.
+	void RenderSystem::collectDraws(FrameInfo& frameInfo, std::vector<Object>& objects) {
+		unsortedDraws.clear();
+		sortKeys.clear();
+		modelIds.clear();
+		objectMatrices.resize(objects.size());
 
-		auto projectionView = frameInfo.camera.getProjectionMatrix() * frameInfo.camera.getViewMatrix();
+		for (uint32_t i = 0; i < objects.size(); i++) {
+			Model* model = objects[i].model.get();
+			objectMatrices[i] = objects[i].transform.mat4();
 
-		int i = 0;
-		for (auto& obj : objects) {
-			i += 1;
+			uint32_t     lod = model->selectLod(frameInfo.camera, objectMatrices[i], LOD_ERROR_THRESHOLD);
+			VertexFormat vertexFormat = model->getVertexFormat();
+			uint32_t     modelId = modelIds.emplace(model, static_cast<uint32_t>(modelIds.size())).first->second;
+			float        depth = model->getNearestViewDepth(frameInfo.camera, objectMatrices[i]);
+			for (uint32_t submesh = 0; submesh < model->getSubmeshCount(); submesh++) {
+				uint32_t material = model->getSubmesh(submesh, lod).material;
+				uint64_t key = makeSortKey(static_cast<uint32_t>(vertexFormat), material, modelId, depth);
 
-			SimplePushConstantData push{};
-			auto modelMatrix = obj.transform.mat4();
-			push.transform = projectionView * modelMatrix;
-			push.normalMatrix = obj.transform.normalMatrix();
+				sortKeys.push_back({ key, static_cast<uint32_t>(unsortedDraws.size()) });
+				unsortedDraws.push_back({ vertexFormat, material, model, lod, i, submesh });
+			}
+		}
+
+		radixSort(sortKeys, sortScratch);
+
+		draws.resize(sortKeys.size());
+		for (size_t i = 0; i < sortKeys.size(); i++) {
+			draws[i] = unsortedDraws[sortKeys[i].index];
+		}
+	}
+
+	// Culls once per frame so the pre-pass and the color pass draw exactly the same meshlets; any
+	// difference would leave pixels failing the color pass's EQUAL test.
+	void RenderSystem::cullClusters(FrameInfo& frameInfo) {
+		for (uint32_t i = 0; i < draws.size(); i++) {
+			DrawItem& draw = draws[i];
+			uint32_t  meshletCount = draw.model->getSubmesh(draw.submesh, draw.lod).meshletCount;
+			if (draw.lod != 0 || meshletCount == 0) {
+				continue;
+			}
 
-			vkCmdPushConstants(
+			auto commands = frameInfo.frameAllocator.allocateIndirect(sizeof(VkDrawIndexedIndirectCommand) * meshletCount);
+			draw.clustered = true;
+			draw.commandOffset = commands.offset;
+			draw.commands = static_cast<VkDrawIndexedIndirectCommand*>(commands.data);
+			draw.commandCount = clusterCuller.cull(
+				*draw.model,
+				draw.submesh,
+				objectMatrices[draw.object],
+				frameInfo.camera,
+				bindless != nullptr ? i : 0,
+				static_cast<VkDrawIndexedIndirectCommand*>(commands.data));
+		}
+	}
+
+	// Every submesh draw gets its own ObjectData so it can carry its material's texture; the draw
+	// index doubles as the instance index the shaders read it with.
+	void RenderSystem::writeObjectData(FrameInfo& frameInfo) {
+		auto objectAllocation = frameInfo.frameAllocator.allocateStorage(sizeof(ObjectData) * draws.size());
+		ObjectData* objectData = static_cast<ObjectData*>(objectAllocation.data);
+		for (uint32_t i = 0; i < draws.size(); i++) {
+			const DrawItem& draw = draws[i];
+			objectData[i].modelMatrix = objectMatrices[draw.object] * draw.model->getDequantizationMatrix();
+			objectData[i].textureIndex = materials != nullptr ? materials->getTextureIndex(draw.material) : BindlessDescriptors::INVALID_INDEX;
+		}
+		objectDataOffset = objectAllocation.offset;
+	}
+
+	// Looks up each draw's pipelines without blocking. Draws whose pipelines are still compiling are
+	// left out of both subpasses, since a draw missing from either would break the EQUAL depth test.
+	// The vertex format is the only state that varies between draws, and the sort key puts it first,
+	// so the cache is only asked again when a run of draws with one format ends. Asking per draw would
+	// alternate color and depth states and defeat its last-lookup check.
+	void RenderSystem::resolvePipelines() {
+		PipelineState colorPassState = depthPrepass ? prepassColorState : colorState;
+		PipelineState depthPassState = depthState;
+
+		size_t        resolvedFormat = VERTEX_FORMAT_COUNT;
+		LivePipeline* colorPipeline = nullptr;
+		LivePipeline* depthPipeline = nullptr;
+
+		pendingPipelineDraws = 0;
+		size_t kept = 0;
+		for (size_t i = 0; i < draws.size(); i++) {
+			DrawItem& draw = draws[i];
+			size_t    format = static_cast<size_t>(draw.vertexFormat);
+
+			if (format != resolvedFormat) {
+				resolvedFormat = format;
+				colorPassState.program = colorPrograms[format];
+				colorPassState.vertexLayout = vertexLayouts[format];
+				colorPipeline = pipelineCache.requestPipeline(colorPassState);
+				if (depthPrepass) {
+					depthPassState.program = depthPrograms[format];
+					depthPassState.vertexLayout = positionLayouts[format];
+					depthPipeline = pipelineCache.requestPipeline(depthPassState);
+				}
+			}
+			draw.colorPipeline = colorPipeline;
+			draw.depthPipeline = depthPipeline;
+
+			if (draw.colorPipeline == nullptr || (depthPrepass && draw.depthPipeline == nullptr)) {
+				pendingPipelineDraws++;
+				continue;
+			}
+			draws[kept++] = draw;
+		}
+		draws.resize(kept);
+	}
+
+	void RenderSystem::prepareDraws(FrameInfo& frameInfo, std::vector<Object>& objects) {
+		clusterCuller.resetStats();
+		collectDraws(frameInfo, objects);
+		resolvePipelines();
+		if (draws.empty()) {
+			return;
+		}
+
+		cullClusters(frameInfo);
+		if (bindless != nullptr) {
+			writeObjectData(frameInfo);
+		}
+	}
+
+	void RenderSystem::renderDepthPrepass(FrameInfo& frameInfo) {
+		if (depthPrepass) {
+			recordDraws(frameInfo, true);
+		}
+	}
+
+	void RenderSystem::renderObjects(FrameInfo& frameInfo) {
+		recordDraws(frameInfo, false);
+	}
+
+	// On the bindless path all per-draw state lives in the object buffer and the bindless texture
+	// array, so the only per-draw commands left are pipeline and vertex/index binds where the sorted
+	// order changes them, and the draw itself. The push constant path adds one push per object.
+	void RenderSystem::recordDraws(FrameInfo& frameInfo, bool depthOnly) {
+		if (draws.empty()) {
+			return;
+		}
+
+		if (bindless != nullptr) {
+			VkDescriptorSet descriptorSets[] = {
+				frameInfo.globalDescriptorSet,
+				bindless->getObjectSet(),
+				bindless->getTextureSet()
+			};
+			uint32_t dynamicOffsets[] = { frameInfo.globalUniformOffset, objectDataOffset };
+			vkCmdBindDescriptorSets(
 				frameInfo.commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 				0,
-				sizeof(SimplePushConstantData),
-				&push
+				3,
+				descriptorSets,
+				2,
+				dynamicOffsets
 			);
+		} else {
+			vkCmdBindDescriptorSets(
+				frameInfo.commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				pipelineLayout,
+				0,
+				1,
+				&frameInfo.globalDescriptorSet,
+				1,
+				&frameInfo.globalUniformOffset
+			);
+		}
+
+		LivePipeline* boundPipeline = nullptr;
+		Model*        boundModel = nullptr;
+		uint32_t      pushedObject = ~0u;
+		for (uint32_t i = 0; i < draws.size(); i++) {
+			const DrawItem& draw = draws[i];
+			LivePipeline*   pipeline = depthOnly ? draw.depthPipeline : draw.colorPipeline;
+			if (pipeline != boundPipeline) {
+				pipeline->bind(frameInfo.commandBuffer);
+				boundPipeline = pipeline;
+			}
+
+			if (bindless == nullptr && draw.object != pushedObject) {
+				SimplePushConstantData push{};
+				push.modelMatrix = objectMatrices[draw.object] * draw.model->getDequantizationMatrix();
+
+				vkCmdPushConstants(
+					frameInfo.commandBuffer,
+					pipelineLayout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					0,
+					sizeof(SimplePushConstantData),
+					&push
+				);
+				pushedObject = draw.object;
+			}
 
-			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
+			if (draw.model != boundModel) {
+				if (depthOnly) {
+					draw.model->bindPositions(frameInfo.commandBuffer);
+				} else {
+					draw.model->bind(frameInfo.commandBuffer);
+				}
+				boundModel = draw.model;
+			}
+			drawModel(frameInfo, draw, bindless != nullptr ? i : 0);
 		}
 	}
-}
\ No newline at end of file
+}
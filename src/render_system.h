@@ -1,33 +1,119 @@
 #pragma once
 
+#include "bindless_descriptors.h"
 #include "camera.h"
+#include "cluster_culler.h"
 #include "engine_device.h"
+#include "engine_swap_chain.h"
 #include "live_pipeline.h"
+#include "material_library.h"
 #include "model.h"
 #include "object.h"
+#include "pipeline_cache.h"
+#include "radix_sort.h"
 #include "frame_info.h"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 
 namespace live {
 	class RenderSystem {
 	public:
-		RenderSystem(LiveDevice& device, VkRenderPass renderPass);
+		// Passing bindless descriptors switches to the bindless path: per-draw data goes through the
+		// object storage buffer instead of push constants. The material library, the one models were
+		// created with, supplies each draw's texture on that path. Pipelines come from pipelineCache,
+		// which must outlive the render system. They are created against renderPass, or without one
+		// for dynamic rendering against colorFormat and depthFormat.
+		RenderSystem(
+			LiveDevice& device,
+			VkRenderPass renderPass,
+			VkFormat colorFormat,
+			VkFormat depthFormat,
+			VkDescriptorSetLayout globalSetLayout,
+			PipelineCache& pipelineCache,
+			BindlessDescriptors* bindlessDescriptors = nullptr,
+			const MaterialLibrary* materialLibrary = nullptr);
 		~RenderSystem();
 
 		RenderSystem(const RenderSystem&) = delete;
 		RenderSystem& operator=(const RenderSystem&) = delete;
 
-		void renderObjects(FrameInfo &frameInfo, std::vector<Object>& objects);
+		// Sorts the objects into draws, culls meshlets and writes the per-draw data. Call once per
+		// frame before the render pass; both subpasses record from its results.
+		void prepareDraws(FrameInfo& frameInfo, std::vector<Object>& objects);
+		// Depth-only draws for LiveSwapChain::DEPTH_PREPASS_SUBPASS, or the start of the dynamic
+		// rendering scope; records nothing while the pre-pass is off
+		void renderDepthPrepass(FrameInfo& frameInfo);
+		// Color draws for LiveSwapChain::COLOR_SUBPASS, or after the pre-pass in the same scope
+		void renderObjects(FrameInfo& frameInfo);
+
+		// With the pre-pass on, the color pass tests depth EQUAL without writing it, so every pixel
+		// is shaded once at the cost of transforming the positions twice. Can change between frames.
+		void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+		bool isDepthPrepassEnabled() const { return depthPrepass; }
+
+		// Meshlet culling results of the last prepareDraws call
+		const ClusterCuller::Stats& getClusterCullingStats() const { return clusterCuller.getStats(); }
+		// Draws the last prepareDraws call left out because a pipeline they need is still compiling
+		uint32_t getPendingPipelineDraws() const { return pendingPipelineDraws; }
 
 	private:
-		void createPipelineLayout();
-		void createPipeline(VkRenderPass renderPass);
+		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		void createPipelineStates(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat);
+		// One submesh of one object
+		struct DrawItem {
+			VertexFormat  vertexFormat;  // selects the program and vertex layout
+			uint32_t      material;
+			Model*        model;
+			uint32_t      lod;
+			uint32_t      object;
+			uint32_t      submesh;
+			LivePipeline* colorPipeline = nullptr;
+			LivePipeline* depthPipeline = nullptr;  // only resolved while the pre-pass is on
+			bool          clustered = false;  // drawn from the culled meshlet commands below
+			uint32_t      commandOffset = 0;  // in the frame allocator
+			uint32_t      commandCount = 0;
+			const VkDrawIndexedIndirectCommand* commands = nullptr;  // mapped, for direct draws
+		};
+
+		void collectDraws(FrameInfo& frameInfo, std::vector<Object>& objects);
+		void resolvePipelines();
+		void cullClusters(FrameInfo& frameInfo);
+		void writeObjectData(FrameInfo& frameInfo);
+		void recordDraws(FrameInfo& frameInfo, bool depthOnly);
+		void drawModel(FrameInfo& frameInfo, const DrawItem& draw, uint32_t firstInstance);
 
 		LiveDevice&                    device;
-		std::unique_ptr<LivePipeline>  livePipeline;
+		PipelineCache&                 pipelineCache;
+		BindlessDescriptors*           bindless;
+		const MaterialLibrary*         materials;
 		VkPipelineLayout               pipelineLayout;
+		ClusterCuller                  clusterCuller{};
+		bool                           depthPrepass = false;
+		uint32_t                       pendingPipelineDraws = 0;
+
+		// Per-pass states; each draw fills in the program and vertex layout of its vertex format
+		PipelineState                  colorState{};         // depth LESS with writes
+		PipelineState                  prepassColorState{};  // depth EQUAL, read only
+		PipelineState                  depthState{};         // position stream, no fragment stage
+
+		// Indexed by VertexFormat
+		using FormatIds = std::array<uint32_t, VERTEX_FORMAT_COUNT>;
+		FormatIds                      colorPrograms{};
+		FormatIds                      depthPrograms{};
+		FormatIds                      vertexLayouts{};
+		FormatIds                      positionLayouts{};
+
+		// Rebuilt every frame, kept to reuse the allocations
+		std::vector<DrawItem>          draws{};
+		std::vector<DrawItem>          unsortedDraws{};
+		std::vector<SortKey>           sortKeys{};
+		std::vector<SortKey>           sortScratch{};
+		std::unordered_map<const Model*, uint32_t> modelIds{};
+		std::vector<glm::mat4>         objectMatrices{};
+		uint32_t                       objectDataOffset = 0;  // bindless ObjectData of this frame's draws
 	};
 }
\ No newline at end of file
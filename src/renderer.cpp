@@ -16,20 +16,38 @@ namespace live {
 		auto extent = window.getExtent();
 		while (extent.width == 0 || extent.height == 0) {
 			glfwWaitEvents();
+			extent = window.getExtent();
 		}
 
-		vkDeviceWaitIdle(device.device());
-
+		// No device wait: the previous swap chain goes through the device's deletion queue and is
+		// destroyed once the frames submitted through it have completed.
 		if (liveSwapChain == nullptr) {
-			liveSwapChain = std::make_unique<LiveSwapChain>(device, extent);
+			liveSwapChain = std::make_unique<LiveSwapChain>(device, extent, presentModePolicy);
 		}
 		else {
 			std::shared_ptr<LiveSwapChain> oldSwapChain = std::move(liveSwapChain);
-			liveSwapChain = std::make_unique<LiveSwapChain>(device, extent, oldSwapChain);
+			liveSwapChain = std::make_unique<LiveSwapChain>(device, extent, oldSwapChain, presentModePolicy);
 
 			if (!oldSwapChain->compareSwapFormats(*liveSwapChain.get())) {
 				throw std::runtime_error("Swap chain image (or depth) format has changed.");
 			}
+
+			oldSwapChain->retireDepthMemory();
+			device.deferDestruction([retired = std::move(oldSwapChain)]() mutable { retired.reset(); });
+		}
+	}
+
+	void Renderer::setPresentModePolicy(PresentModePolicy policy) {
+		if (policy == presentModePolicy) {
+			return;
+		}
+
+		presentModePolicy = policy;
+
+		if (frameStarted) {
+			presentModeChanged = true;
+		} else {
+			recreateSwapChain();
 		}
 	}
 
@@ -56,6 +74,9 @@ namespace live {
 	VkCommandBuffer Renderer::beginFrame() {
 		assert(!frameStarted && "Cannot call beginFrame while already in progress");
 
+		device.collectGarbage();
+		device.updateMemoryBudget();
+
 		auto result = liveSwapChain->acquireNextImage(&currentImageIndex);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -68,6 +89,7 @@ namespace live {
 		}
 
 		frameStarted = true;
+		device.beginFrameDeletions();
 
 		auto commandBuffer = getCurrentCommandBuffer();
 
@@ -90,9 +112,11 @@ namespace live {
 		}
 
 		auto result = liveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		device.submitFrameDeletions(liveSwapChain->getSubmittedFrameValue());
 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.windowResized()) {
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.windowResized() || presentModeChanged) {
 			window.resetWindowResizedFlag();
+			presentModeChanged = false;
 			recreateSwapChain();
 		} else if (result != VK_SUCCESS) {
 			throw std::runtime_error("Failed to present swapchain image.");
@@ -106,6 +130,12 @@ namespace live {
 		assert(frameStarted && "Cannot call beginSwapChainRenderPass while frame is in progress");
 		assert(commandBuffer == getCurrentCommandBuffer() && "Cannot begin render pass on command buffer from a different frame");
 
+		if (liveSwapChain->usesDynamicRendering()) {
+			beginDynamicRendering(commandBuffer);
+			setViewportAndScissor(commandBuffer);
+			return;
+		}
+
 		std::array<VkClearValue, 2> clearValues{};
 		clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
 		clearValues[1].depthStencil = { 1.0f, 0 };
@@ -120,7 +150,10 @@ namespace live {
 		renderPassInfo.pClearValues = clearValues.data();
 
 		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		setViewportAndScissor(commandBuffer);
+	}
 
+	void Renderer::setViewportAndScissor(VkCommandBuffer commandBuffer) {
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
@@ -134,10 +167,118 @@ namespace live {
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);		
 	}
 
+	void Renderer::nextSwapChainSubpass(VkCommandBuffer commandBuffer) {
+		assert(frameStarted && "Cannot call nextSwapChainSubpass while frame is in progress");
+		assert(commandBuffer == getCurrentCommandBuffer() && "Cannot advance render pass on command buffer from a different frame");
+
+		if (!liveSwapChain->usesDynamicRendering()) {
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+		}
+	}
+
 	void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
 		assert(frameStarted && "Cannot call endSwapChainRenderPass while frame is in progress");
 		assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end render pass on command buffer from a different frame");
 
-		vkCmdEndRenderPass(commandBuffer);
+		if (liveSwapChain->usesDynamicRendering()) {
+			endDynamicRendering(commandBuffer);
+		} else {
+			vkCmdEndRenderPass(commandBuffer);
+		}
+	}
+
+	// Does what the render pass's attachment descriptions and external dependencies do: moves the
+	// swap chain image out of whatever presentation left it in, and orders the depth clear after
+	// the slot's previous frame tested against the same image.
+	void Renderer::beginDynamicRendering(VkCommandBuffer commandBuffer) {
+		VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		VkFormat depthFormat = liveSwapChain->getSwapChainDepthFormat();
+		if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+			depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+
+		std::array<VkImageMemoryBarrier, 2> barriers{};
+		barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[0].srcAccessMask = 0;
+		barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[0].newLayout = LiveSwapChain::COLOR_ATTACHMENT_LAYOUT;
+		barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].image = liveSwapChain->getImage(currentImageIndex);
+		barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = LiveSwapChain::DEPTH_ATTACHMENT_LAYOUT;
+		barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].image = liveSwapChain->getDepthImage();
+		barriers[1].subresourceRange = { depthAspect, 0, 1, 0, 1 };
+
+		// The color stage is the one the image acquisition semaphore is waited on at
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+
+		VkRenderingAttachmentInfo colorAttachment{};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		colorAttachment.imageView = liveSwapChain->getImageView(currentImageIndex);
+		colorAttachment.imageLayout = LiveSwapChain::COLOR_ATTACHMENT_LAYOUT;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue.color = { 0.01f, 0.01f, 0.01f, 1.0f };
+
+		// Like the render pass's depth attachment: cleared and discarded, never leaving tile memory
+		VkRenderingAttachmentInfo depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = liveSwapChain->getDepthImageView();
+		depthAttachment.imageLayout = LiveSwapChain::DEPTH_ATTACHMENT_LAYOUT;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+		VkRenderingInfo renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = liveSwapChain->getSwapChainExtent();
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &colorAttachment;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		device.cmdBeginRendering(commandBuffer, renderingInfo);
+	}
+
+	void Renderer::endDynamicRendering(VkCommandBuffer commandBuffer) {
+		device.cmdEndRendering(commandBuffer);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = LiveSwapChain::COLOR_ATTACHMENT_LAYOUT;
+		barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = liveSwapChain->getImage(currentImageIndex);
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		// Presentation waits on the render finished semaphore, which covers everything submitted
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
 	}
 }
\ No newline at end of file
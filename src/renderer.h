@@ -21,13 +21,27 @@ namespace live {
 
 		VkCommandBuffer beginFrame();
 		void endFrame();
+		// The render pass begins in the depth pre-pass subpass; nextSwapChainSubpass moves on to color.
+		// With dynamic rendering both are one rendering scope on the swap chain image and the frame
+		// slot's depth image, and nextSwapChainSubpass records nothing.
 		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		void nextSwapChainSubpass(VkCommandBuffer commandBuffer);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+		// VK_NULL_HANDLE with dynamic rendering: create pipelines against the formats instead
 		VkRenderPass getSwapChainRenderPass() const { return liveSwapChain->getRenderPass(); }
+		VkFormat getSwapChainImageFormat() const { return liveSwapChain->getSwapChainImageFormat(); }
+		VkFormat getSwapChainDepthFormat() const { return liveSwapChain->getSwapChainDepthFormat(); }
 		float getAspectRatio() const { return liveSwapChain->extentAspectRatio(); }
+		VkExtent2D getSwapChainExtent() const { return liveSwapChain->getSwapChainExtent(); }
 		bool frameInProgess() const { return frameStarted; }
 
+		// Requests a present mode policy; the swap chain is rebuilt immediately, or at the end of
+		// the current frame if one is being recorded. getPresentMode reports the mode actually granted.
+		void setPresentModePolicy(PresentModePolicy policy);
+		PresentModePolicy getPresentModePolicy() const { return presentModePolicy; }
+		VkPresentModeKHR getPresentMode() const { return liveSwapChain->getPresentMode(); }
+
 		VkCommandBuffer getCurrentCommandBuffer() const { 
 			assert(frameStarted && "Cannot get command buffer when frame is not in progress");
 			return commandBuffers[currentFrameIndex]; 
@@ -42,6 +56,9 @@ namespace live {
 		void createCommandBuffers();
 		void freeCommandBuffers();
 		void recreateSwapChain();
+		void beginDynamicRendering(VkCommandBuffer commandBuffer);
+		void endDynamicRendering(VkCommandBuffer commandBuffer);
+		void setViewportAndScissor(VkCommandBuffer commandBuffer);
 		
 		LiveWindow&                    window;
 		LiveDevice&                    device;
@@ -50,5 +67,7 @@ namespace live {
 		uint32_t                       currentImageIndex;
 		int                            currentFrameIndex{ 0 };
 		bool                           frameStarted{ false };
+		PresentModePolicy              presentModePolicy{ PresentModePolicy::VSync };
+		bool                           presentModeChanged{ false };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "sampler_cache.h"
+#include "utility.h"
+
+#include <cassert>
+#include <stdexcept>
+
+
+namespace live {
+	SamplerCache::~SamplerCache() {
+		for (const auto& entry : samplers) {
+			vkDestroySampler(liveDevice.device(), entry.second, nullptr);
+		}
+	}
+
+	VkSamplerCreateInfo SamplerCache::defaultSamplerInfo() const {
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.anisotropyEnable = VK_TRUE;
+		samplerInfo.maxAnisotropy = liveDevice.properties.limits.maxSamplerAnisotropy;
+		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+		return samplerInfo;
+	}
+
+	VkSampler SamplerCache::getSampler(const VkSamplerCreateInfo& createInfo) {
+		assert(createInfo.pNext == nullptr && "Sampler create info chains are not cached");
+
+		Key key{ createInfo };
+		auto found = samplers.find(key);
+		if (found != samplers.end()) {
+			return found->second;
+		}
+
+		VkSampler sampler;
+		if (vkCreateSampler(liveDevice.device(), &createInfo, nullptr, &sampler) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create sampler.");
+		}
+		samplers.emplace(key, sampler);
+		return sampler;
+	}
+
+	bool SamplerCache::Key::operator==(const Key& other) const {
+		const VkSamplerCreateInfo& a = createInfo;
+		const VkSamplerCreateInfo& b = other.createInfo;
+		return a.flags == b.flags &&
+			a.magFilter == b.magFilter &&
+			a.minFilter == b.minFilter &&
+			a.mipmapMode == b.mipmapMode &&
+			a.addressModeU == b.addressModeU &&
+			a.addressModeV == b.addressModeV &&
+			a.addressModeW == b.addressModeW &&
+			a.mipLodBias == b.mipLodBias &&
+			a.anisotropyEnable == b.anisotropyEnable &&
+			a.maxAnisotropy == b.maxAnisotropy &&
+			a.compareEnable == b.compareEnable &&
+			a.compareOp == b.compareOp &&
+			a.minLod == b.minLod &&
+			a.maxLod == b.maxLod &&
+			a.borderColor == b.borderColor &&
+			a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+	}
+
+	size_t SamplerCache::KeyHash::operator()(const Key& key) const {
+		const VkSamplerCreateInfo& info = key.createInfo;
+		size_t seed = 0;
+		hashCombine(
+			seed,
+			static_cast<uint32_t>(info.magFilter),
+			static_cast<uint32_t>(info.minFilter),
+			static_cast<uint32_t>(info.mipmapMode),
+			static_cast<uint32_t>(info.addressModeU),
+			static_cast<uint32_t>(info.addressModeV),
+			static_cast<uint32_t>(info.addressModeW),
+			info.mipLodBias,
+			info.anisotropyEnable,
+			info.maxAnisotropy,
+			info.maxLod);
+		return seed;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "engine_device.h"
+
+#include <unordered_map>
+
+
+namespace live {
+	// Deduplicates VkSamplers. Most textures in a scene sample the same way, and devices cap the
+	// number of live samplers (maxSamplerAllocationCount can be as low as 4000), so textures ask the
+	// cache instead of creating their own. Samplers live as long as the cache.
+	class SamplerCache {
+	public:
+		explicit SamplerCache(LiveDevice& device) : liveDevice{ device } {}
+		~SamplerCache();
+
+		SamplerCache(const SamplerCache&) = delete;
+		SamplerCache& operator=(const SamplerCache&) = delete;
+
+		// Trilinear, repeating, with the device's maximum anisotropy and no LOD clamp, so one sampler
+		// serves textures of any mip count
+		VkSamplerCreateInfo defaultSamplerInfo() const;
+
+		// createInfo.pNext must be null
+		VkSampler getSampler(const VkSamplerCreateInfo& createInfo);
+		VkSampler getDefaultSampler() { return getSampler(defaultSamplerInfo()); }
+
+	private:
+		struct Key {
+			VkSamplerCreateInfo createInfo;
+
+			bool operator==(const Key& other) const;
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		LiveDevice&                                 liveDevice;
+		std::unordered_map<Key, VkSampler, KeyHash> samplers{};
+	};
+}
@@ -0,0 +1,524 @@
+#include "texture.h"
+#include "buffer.h"
+#include "mapped_file.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+	const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// Fields following the identifier; the 64-bit ones are read separately because the file packs
+	// them at offsets a C++ struct would pad
+	struct Ktx2Header {
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+	};
+
+	constexpr size_t KTX2_HEADER_OFFSET = sizeof(KTX2_IDENTIFIER);
+	constexpr size_t KTX2_LEVEL_INDEX_OFFSET = 80;
+
+	struct Ktx2Level {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	uint32_t fullMipChain(uint32_t width, uint32_t height) {
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+			levels++;
+		}
+		return levels;
+	}
+
+	void transitionMips(
+		VkCommandBuffer commandBuffer,
+		VkImage image,
+		uint32_t baseMip,
+		uint32_t mipCount,
+		VkImageLayout oldLayout,
+		VkImageLayout newLayout,
+		VkAccessFlags srcAccess,
+		VkAccessFlags dstAccess,
+		VkPipelineStageFlags srcStage,
+		VkPipelineStageFlags dstStage) {
+		if (mipCount == 0) {
+			return;
+		}
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseMip, mipCount, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	bool isBoxFilterable(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void toShaderRead(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t mipCount, VkImageLayout oldLayout, VkAccessFlags srcAccess) {
+		transitionMips(
+			commandBuffer,
+			image,
+			baseMip,
+			mipCount,
+			oldLayout,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			srcAccess,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+}
+
+
+namespace live {
+	void Texture::Builder::loadFile(const std::string& filepath, bool srgb) {
+		std::string extension = filepath.substr(std::min(filepath.find_last_of('.'), filepath.size()));
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		if (extension == ".ktx2") {
+			loadKtx2(filepath);
+		} else {
+			loadImage(filepath, srgb);
+		}
+	}
+
+	// Only plain 2D KTX2 files are accepted. Supercompressed files (Basis Universal, zstd) would need a
+	// CPU transcode, which is exactly what this path exists to avoid; convert them offline.
+	void Texture::Builder::loadKtx2(const std::string& filepath) {
+		MappedFile file{ filepath };
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(file.data());
+
+		if (file.size() < KTX2_LEVEL_INDEX_OFFSET || std::memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+			throw std::runtime_error(filepath + ": not a KTX2 file");
+		}
+
+		Ktx2Header header;
+		std::memcpy(&header, bytes + KTX2_HEADER_OFFSET, sizeof(header));
+
+		if (header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme != 0) {
+			throw std::runtime_error(filepath + ": supercompressed KTX2 textures are not supported");
+		}
+		if (header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+			throw std::runtime_error(filepath + ": only 2D KTX2 textures are supported");
+		}
+
+		// levelCount 0 asks the loader to generate the chain from the single stored level
+		uint32_t storedLevels = std::max(header.levelCount, 1u);
+		if (file.size() < KTX2_LEVEL_INDEX_OFFSET + storedLevels * sizeof(Ktx2Level)) {
+			throw std::runtime_error(filepath + ": truncated KTX2 level index");
+		}
+
+		std::vector<Ktx2Level> index(storedLevels);
+		std::memcpy(index.data(), bytes + KTX2_LEVEL_INDEX_OFFSET, storedLevels * sizeof(Ktx2Level));
+
+		// Levels are stored smallest first and padded to the format's block alignment, so copying the
+		// whole span keeps every level's offset valid for vkCmdCopyBufferToImage
+		uint64_t dataBegin = ~0ull;
+		uint64_t dataEnd = 0;
+		for (const auto& level : index) {
+			if (level.byteOffset + level.byteLength > file.size()) {
+				throw std::runtime_error(filepath + ": KTX2 level data out of bounds");
+			}
+			dataBegin = std::min(dataBegin, level.byteOffset);
+			dataEnd = std::max(dataEnd, level.byteOffset + level.byteLength);
+		}
+
+		format = static_cast<VkFormat>(header.vkFormat);
+		width = header.pixelWidth;
+		height = header.pixelHeight;
+		data.assign(bytes + dataBegin, bytes + dataEnd);
+
+		levels.clear();
+		for (const auto& level : index) {
+			levels.push_back({ level.byteOffset - dataBegin, level.byteLength });
+		}
+
+		generateMipmaps = header.levelCount == 0;
+		mipLevels = generateMipmaps ? fullMipChain(width, height) : storedLevels;
+	}
+
+	void Texture::Builder::loadImage(const std::string& filepath, bool srgb) {
+		int imageWidth, imageHeight, channels;
+		stbi_uc* pixels = stbi_load(filepath.c_str(), &imageWidth, &imageHeight, &channels, STBI_rgb_alpha);
+		if (pixels == nullptr) {
+			throw std::runtime_error(filepath + ": " + stbi_failure_reason());
+		}
+
+		format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		width = static_cast<uint32_t>(imageWidth);
+		height = static_cast<uint32_t>(imageHeight);
+		data.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(pixels);
+
+		levels = { { 0, data.size() } };
+		mipLevels = fullMipChain(width, height);
+		generateMipmaps = true;
+	}
+
+	// Channels are averaged as stored, sRGB included, so the result can be a little darker than the
+	// GPU blit of the same image
+	bool Texture::Builder::generateLevels() {
+		if (levels.size() >= mipLevels) {
+			return true;
+		}
+		if (!isBoxFilterable(format)) {
+			return false;
+		}
+
+		for (uint32_t level = static_cast<uint32_t>(levels.size()); level < mipLevels; level++) {
+			uint32_t sourceWidth = getLevelWidth(level - 1);
+			uint32_t sourceHeight = getLevelHeight(level - 1);
+			uint32_t levelWidth = getLevelWidth(level);
+			uint32_t levelHeight = getLevelHeight(level);
+
+			VkDeviceSize offset = data.size();
+			VkDeviceSize size = static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4;
+			data.resize(offset + size);
+
+			const uint8_t* source = data.data() + levels[level - 1].offset;
+			uint8_t*       target = data.data() + offset;
+			for (uint32_t y = 0; y < levelHeight; y++) {
+				// Odd sizes clamp the second row/column rather than reading past the edge
+				const uint8_t* row0 = source + static_cast<size_t>(std::min(2 * y, sourceHeight - 1)) * sourceWidth * 4;
+				const uint8_t* row1 = source + static_cast<size_t>(std::min(2 * y + 1, sourceHeight - 1)) * sourceWidth * 4;
+				for (uint32_t x = 0; x < levelWidth; x++) {
+					size_t column0 = static_cast<size_t>(std::min(2 * x, sourceWidth - 1)) * 4;
+					size_t column1 = static_cast<size_t>(std::min(2 * x + 1, sourceWidth - 1)) * 4;
+					for (size_t channel = 0; channel < 4; channel++) {
+						uint32_t sum = row0[column0 + channel] + row0[column1 + channel] + row1[column0 + channel] + row1[column1 + channel];
+						*target++ = static_cast<uint8_t>((sum + 2) / 4);
+					}
+				}
+			}
+
+			levels.push_back({ offset, size });
+		}
+
+		generateMipmaps = false;
+		return true;
+	}
+
+	VkDeviceSize Texture::Builder::getStoredSize(uint32_t firstLevel) const {
+		VkDeviceSize size = 0;
+		for (size_t level = firstLevel; level < levels.size(); level++) {
+			size += levels[level].size;
+		}
+		return size;
+	}
+
+	Texture::Texture(
+		LiveDevice& device,
+		SamplerCache& samplerCache,
+		const Texture::Builder& builder,
+		uint32_t firstLevel,
+		VkCommandBuffer commandBuffer)
+		: liveDevice{ device },
+		format{ builder.format },
+		extent{ builder.getLevelWidth(firstLevel), builder.getLevelHeight(firstLevel) } {
+		assert(firstLevel < builder.levels.size() && "Texture needs at least one level of data");
+
+		VkFormatFeatureFlags features = liveDevice.getFormatProperties(format).optimalTilingFeatures;
+		if ((features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+			throw std::runtime_error("Texture format " + std::to_string(format) + " cannot be sampled on this device.");
+		}
+
+		// Block-compressed formats can't be blit targets, so they keep the levels they were stored with
+		const VkFormatFeatureFlags blitFeatures =
+			VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		uint32_t storedLevels = static_cast<uint32_t>(builder.levels.size()) - firstLevel;
+		uint32_t chainLevels = builder.mipLevels - firstLevel;
+		bool generateMipmaps = builder.generateMipmaps && chainLevels > storedLevels && (features & blitFeatures) == blitFeatures;
+		mipLevels = generateMipmaps ? chainLevels : storedLevels;
+
+		// Transfer source for the mip blits, and for the copy into a texture that replaces this one
+		createImage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		upload(builder, firstLevel, generateMipmaps, commandBuffer);
+		createImageView();
+		sampler = samplerCache.getDefaultSampler();
+	}
+
+	Texture::Texture(
+		LiveDevice& device,
+		const Texture::Builder& builder,
+		uint32_t firstLevel,
+		const Texture& resident,
+		uint32_t residentLevel,
+		const std::vector<StagedLevel>& stagedLevels,
+		VkCommandBuffer commandBuffer)
+		: liveDevice{ device },
+		sampler{ resident.sampler },
+		format{ resident.format },
+		extent{ builder.getLevelWidth(firstLevel), builder.getLevelHeight(firstLevel) },
+		mipLevels{ residentLevel + resident.mipLevels - firstLevel } {
+		assert(firstLevel < residentLevel + resident.mipLevels && "Texture needs at least one resident level");
+		assert(stagedLevels.size() == (firstLevel < residentLevel ? residentLevel - firstLevel : 0) && "Every level above the resident ones needs data");
+
+		createImage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		copyLevels(resident, firstLevel < residentLevel ? 0 : firstLevel - residentLevel, stagedLevels, commandBuffer);
+		createImageView();
+	}
+
+	Texture::~Texture() {
+		VkDevice       device = liveDevice.device();
+		VkImageView    retiredView = imageView;
+		VkImage        retiredImage = image;
+		VkDeviceMemory retiredMemory = imageMemory;
+		liveDevice.retireMemory(retiredMemory);
+		liveDevice.deferDestruction([&owner = liveDevice, device, retiredView, retiredImage, retiredMemory]() {
+			vkDestroyImageView(device, retiredView, nullptr);
+			vkDestroyImage(device, retiredImage, nullptr);
+			owner.freeMemory(retiredMemory);
+		});
+	}
+
+	std::unique_ptr<Texture> Texture::createTextureFromFile(LiveDevice& device, SamplerCache& samplerCache, const std::string& filepath, bool srgb) {
+		Builder builder{};
+		builder.loadFile(filepath, srgb);
+		return std::make_unique<Texture>(device, samplerCache, builder);
+	}
+
+	void Texture::createImage(VkImageUsageFlags usage) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { extent.width, extent.height, 1 };
+		imageInfo.mipLevels = mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		liveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(liveDevice.device(), image, &memoryRequirements);
+		memorySize = memoryRequirements.size;
+	}
+
+	// Copies the stored levels from firstLevel down in one submission and, if asked, blits each
+	// missing level from the one above it. Every level ends in SHADER_READ_ONLY_OPTIMAL.
+	void Texture::upload(const Texture::Builder& builder, uint32_t firstLevel, bool generateMipmaps, VkCommandBuffer commandBuffer) {
+		uint32_t storedLevels = static_cast<uint32_t>(builder.levels.size()) - firstLevel;
+
+		// Only the span holding the uploaded levels is staged
+		VkDeviceSize dataBegin = builder.data.size();
+		VkDeviceSize dataEnd = 0;
+		for (uint32_t level = firstLevel; level < builder.levels.size(); level++) {
+			dataBegin = std::min(dataBegin, builder.levels[level].offset);
+			dataEnd = std::max(dataEnd, builder.levels[level].offset + builder.levels[level].size);
+		}
+
+		Buffer stagingBuffer{
+			liveDevice,
+			1,
+			static_cast<uint32_t>(dataEnd - dataBegin),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		};
+
+		stagingBuffer.map();
+		stagingBuffer.writeToBuffer((void*)(builder.data.data() + dataBegin));
+
+		std::vector<VkBufferImageCopy> regions(storedLevels);
+		for (uint32_t level = 0; level < storedLevels; level++) {
+			VkBufferImageCopy& region = regions[level];
+			region = {};
+			region.bufferOffset = builder.levels[firstLevel + level].offset - dataBegin;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			region.imageExtent = { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1 };
+		}
+
+		// The staging buffer's destructor defers its release, so recording into a frame's command
+		// buffer needs nothing more than a caller-side submit
+		bool submit = commandBuffer == VK_NULL_HANDLE;
+		if (submit) {
+			commandBuffer = liveDevice.beginSingleTimeCommands();
+		}
+
+		transitionMips(
+			commandBuffer,
+			image,
+			0,
+			mipLevels,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		vkCmdCopyBufferToImage(
+			commandBuffer,
+			stagingBuffer.getBuffer(),
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			storedLevels,
+			regions.data());
+
+		if (!generateMipmaps) {
+			toShaderRead(commandBuffer, image, 0, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+			if (submit) {
+				liveDevice.endSingleTimeCommands(commandBuffer);
+			}
+			return;
+		}
+
+		// Every stored level but the last is final; the last one is the source of the first blit
+		toShaderRead(commandBuffer, image, 0, storedLevels - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+		for (uint32_t level = storedLevels; level < mipLevels; level++) {
+			uint32_t source = level - 1;
+			transitionMips(
+				commandBuffer,
+				image,
+				source,
+				1,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+			VkImageBlit blit{};
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, source, 0, 1 };
+			blit.srcOffsets[1] = {
+				static_cast<int32_t>(std::max(extent.width >> source, 1u)),
+				static_cast<int32_t>(std::max(extent.height >> source, 1u)),
+				1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			blit.dstOffsets[1] = {
+				static_cast<int32_t>(std::max(extent.width >> level, 1u)),
+				static_cast<int32_t>(std::max(extent.height >> level, 1u)),
+				1 };
+
+			vkCmdBlitImage(
+				commandBuffer,
+				image,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				image,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1,
+				&blit,
+				VK_FILTER_LINEAR);
+
+			toShaderRead(commandBuffer, image, source, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT);
+		}
+
+		toShaderRead(commandBuffer, image, mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+		if (submit) {
+			liveDevice.endSingleTimeCommands(commandBuffer);
+		}
+	}
+
+	// The shared levels are resident's from levelOffset on and this image's after the staged ones.
+	// Frames sampling resident were submitted earlier on the same queue, so the barrier that takes it
+	// out of SHADER_READ_ONLY_OPTIMAL waits for them; it goes back once the copy is done.
+	void Texture::copyLevels(const Texture& resident, uint32_t levelOffset, const std::vector<StagedLevel>& stagedLevels, VkCommandBuffer commandBuffer) {
+		uint32_t stagedCount = static_cast<uint32_t>(stagedLevels.size());
+		uint32_t copiedCount = mipLevels - stagedCount;
+
+		transitionMips(
+			commandBuffer,
+			image,
+			0,
+			mipLevels,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+		transitionMips(
+			commandBuffer,
+			resident.image,
+			levelOffset,
+			copiedCount,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			0,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		std::vector<VkImageCopy> regions(copiedCount);
+		for (uint32_t i = 0; i < copiedCount; i++) {
+			uint32_t level = stagedCount + i;
+			VkImageCopy& region = regions[i];
+			region = {};
+			region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, levelOffset + i, 0, 1 };
+			region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			region.extent = { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1 };
+		}
+		vkCmdCopyImage(
+			commandBuffer,
+			resident.image,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			copiedCount,
+			regions.data());
+
+		// Staged levels can sit in different buffers, so each gets its own copy
+		for (uint32_t level = 0; level < stagedCount; level++) {
+			VkBufferImageCopy region{};
+			region.bufferOffset = stagedLevels[level].offset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			region.imageExtent = { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1 };
+			vkCmdCopyBufferToImage(commandBuffer, stagedLevels[level].buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		}
+
+		toShaderRead(commandBuffer, resident.image, levelOffset, copiedCount, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0);
+		toShaderRead(commandBuffer, image, 0, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+
+	void Texture::createImageView() {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+		if (vkCreateImageView(liveDevice.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create texture image view.");
+		}
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "engine_device.h"
+#include "sampler_cache.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace live {
+	// Sampled 2D texture in device local memory.
+	//
+	// KTX2 files are uploaded as stored: block-compressed BCn/ETC2/ASTC levels go to the GPU without
+	// any CPU decode, and a device that can't sample the format is an error rather than a reason to
+	// decompress. PNG, JPEG and the other stb_image formats are decoded to RGBA8 and get their mip
+	// chain from vkCmdBlitImage on the GPU.
+	class Texture {
+	public:
+		// One mip level inside Builder::data
+		struct Level {
+			VkDeviceSize offset;
+			VkDeviceSize size;
+		};
+
+		struct Builder {
+			VkFormat             format = VK_FORMAT_UNDEFINED;
+			uint32_t             width = 0;
+			uint32_t             height = 0;
+			uint32_t             mipLevels = 1;  // levels the image is created with
+			std::vector<Level>   levels{};       // levels with data, from level 0 down
+			std::vector<uint8_t> data{};
+			bool                 generateMipmaps = false;  // blit the missing levels from the last stored one
+
+			// .ktx2 files are loaded directly, anything else through stb_image. srgb only applies to the
+			// latter; KTX2 files carry their own format.
+			void loadFile(const std::string& filepath, bool srgb);
+			void loadKtx2(const std::string& filepath);
+			void loadImage(const std::string& filepath, bool srgb);
+			// Box-filters the missing levels on the CPU so every level has data. Only 4-byte
+			// uncompressed formats can be filtered; returns false for anything else.
+			bool generateLevels();
+
+			uint32_t getLevelWidth(uint32_t level) const { return std::max(width >> level, 1u); }
+			uint32_t getLevelHeight(uint32_t level) const { return std::max(height >> level, 1u); }
+			// Bytes of the stored levels from firstLevel down
+			VkDeviceSize getStoredSize(uint32_t firstLevel) const;
+		};
+
+		// One level's data in a staging buffer that outlives the command buffer copying it
+		struct StagedLevel {
+			VkBuffer     buffer;
+			VkDeviceSize offset;
+		};
+
+		// firstLevel drops the builder's largest levels: the image is created at the size of that
+		// level with the remaining chain, which is how TextureStreamer keeps textures partially
+		// resident. With a command buffer the upload is recorded into it instead of being submitted
+		// and waited on; the staging memory is released once that submission completes.
+		Texture(
+			LiveDevice& device,
+			SamplerCache& samplerCache,
+			const Texture::Builder& builder,
+			uint32_t firstLevel = 0,
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE);
+		// Moves a partially resident texture to a new first level without going back to the CPU for
+		// what the GPU already has. resident holds the builder's chain from residentLevel; the levels
+		// both images share are copied image to image, and stagedLevels fills the finer ones from
+		// firstLevel, one per level. The builder only provides the format and level sizes, so its data
+		// may be gone. Recorded into commandBuffer.
+		Texture(
+			LiveDevice& device,
+			const Texture::Builder& builder,
+			uint32_t firstLevel,
+			const Texture& resident,
+			uint32_t residentLevel,
+			const std::vector<StagedLevel>& stagedLevels,
+			VkCommandBuffer commandBuffer);
+		~Texture();
+
+		Texture(const Texture&) = delete;
+		Texture& operator=(const Texture&) = delete;
+
+		static std::unique_ptr<Texture> createTextureFromFile(
+			LiveDevice& device,
+			SamplerCache& samplerCache,
+			const std::string& filepath,
+			bool srgb = true);
+
+		VkDescriptorImageInfo getDescriptorImageInfo() const { return { sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }; }
+
+		VkFormat getFormat() const { return format; }
+		VkExtent2D getExtent() const { return extent; }
+		uint32_t getMipLevels() const { return mipLevels; }
+		VkDeviceSize getMemorySize() const { return memorySize; }
+
+	private:
+		void createImage(VkImageUsageFlags usage);
+		void upload(const Texture::Builder& builder, uint32_t firstLevel, bool generateMipmaps, VkCommandBuffer commandBuffer);
+		void copyLevels(const Texture& resident, uint32_t levelOffset, const std::vector<StagedLevel>& stagedLevels, VkCommandBuffer commandBuffer);
+		void createImageView();
+
+		LiveDevice&    liveDevice;
+
+		VkImage        image = VK_NULL_HANDLE;
+		VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+		VkImageView    imageView = VK_NULL_HANDLE;
+		VkSampler      sampler = VK_NULL_HANDLE;  // owned by the SamplerCache
+
+		VkFormat       format;
+		VkExtent2D     extent;
+		uint32_t       mipLevels;
+		VkDeviceSize   memorySize = 0;
+	};
+}
@@ -0,0 +1,350 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace {
+	// Valid bufferOffset for every texel block size a texture can have
+	constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+}
+
+
+namespace live {
+	TextureStreamer::TextureStreamer(
+		LiveDevice& device,
+		SamplerCache& samplerCache,
+		BindlessDescriptors& bindlessDescriptors,
+		MaterialLibrary& materialLibrary,
+		const Settings& settings)
+		: liveDevice{ device },
+		samplerCache{ samplerCache },
+		bindless{ bindlessDescriptors },
+		materialLibrary{ materialLibrary },
+		settings{ settings },
+		residentLimit{ settings.memoryBudget } {
+		budgetCallback = liveDevice.addMemoryBudgetCallback(
+			[this](const MemoryHeapUsage& heap, VkDeviceSize excess) { onMemoryPressure(heap, excess); });
+
+		staging = std::make_unique<Buffer>(
+			liveDevice,
+			settings.uploadBudget,
+			LiveSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			STAGING_ALIGNMENT
+		);
+		staging->map();
+		stagingCapacity = staging->getBufferSize() / LiveSwapChain::MAX_FRAMES_IN_FLIGHT;
+	}
+
+	TextureStreamer::~TextureStreamer() { liveDevice.removeMemoryBudgetCallback(budgetCallback); }
+
+	// Runs between frames, so the eviction itself waits for the next update, which has a frame to
+	// retire bindless slots in
+	void TextureStreamer::onMemoryPressure(const MemoryHeapUsage& heap, VkDeviceSize excess) {
+		if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0) {
+			evictionRequest = std::max(evictionRequest, excess);
+		}
+	}
+
+	void TextureStreamer::loadMaterialTextures(bool srgb) {
+		std::unordered_map<std::string, uint32_t> loaded{};
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			loaded.emplace(entries[i].filepath, i);
+		}
+
+		materialEntries.resize(materialLibrary.getMaterialCount(), NO_ENTRY);
+		for (uint32_t id = 0; id < materialLibrary.getMaterialCount(); id++) {
+			const std::string& filepath = materialLibrary.getMaterial(id).diffuseTexture;
+			if (filepath.empty() || materialEntries[id] != NO_ENTRY) {
+				continue;
+			}
+
+			auto found = loaded.find(filepath);
+			if (found == loaded.end()) {
+				uint32_t entryIndex = NO_ENTRY;
+				try {
+					Entry entry{};
+					entry.filepath = filepath;
+					entry.srgb = srgb;
+					entry.source.loadFile(filepath, srgb);
+
+					// Streaming needs every level on the CPU; a texture whose levels can only be blit on
+					// the GPU stays a tail of one full chain
+					entry.source.generateLevels();
+
+					uint32_t lastLevel = static_cast<uint32_t>(entry.source.levels.size()) - 1;
+					while (entry.tailLevel < lastLevel &&
+						std::max(entry.source.getLevelWidth(entry.tailLevel), entry.source.getLevelHeight(entry.tailLevel)) > settings.residentSize) {
+						entry.tailLevel++;
+					}
+					entry.wantedLevel = entry.tailLevel;
+
+					entry.texture = std::make_unique<Texture>(liveDevice, samplerCache, entry.source, entry.tailLevel);
+					entry.textureIndex = bindless.registerTexture(entry.texture->getDescriptorImageInfo());
+					entry.residentLevel = entry.tailLevel;
+					residentMemory += entry.texture->getMemorySize();
+					uploadedBytes += entry.source.getStoredSize(entry.tailLevel);
+
+					// Only the levels that aren't on the GPU stay on the CPU
+					entry.levelData.resize(entry.tailLevel);
+					for (uint32_t level = 0; level < entry.tailLevel; level++) {
+						const Texture::Level& stored = entry.source.levels[level];
+						entry.levelData[level].assign(entry.source.data.begin() + stored.offset, entry.source.data.begin() + stored.offset + stored.size);
+					}
+					entry.source.data = {};
+
+					entryIndex = static_cast<uint32_t>(entries.size());
+					entries.push_back(std::move(entry));
+				}
+				catch (const std::runtime_error& error) {
+					std::cerr << "Skipping texture: " << error.what() << std::endl;
+				}
+				found = loaded.emplace(filepath, entryIndex).first;
+			}
+
+			if (found->second == NO_ENTRY) {
+				continue;
+			}
+
+			Entry& entry = entries[found->second];
+			entry.materials.push_back(id);
+			materialEntries[id] = found->second;
+			materialLibrary.setTextureIndex(id, entry.textureIndex);
+		}
+	}
+
+	void TextureStreamer::update(FrameInfo& frameInfo, std::vector<Object>& objects, float viewportHeight) {
+		frameCount++;
+		frameUploadBytes = 0;
+		stagingBase = stagingCapacity * frameInfo.frameIndex;
+		stagingOffset = 0;
+
+		// This frame slot's previous submission has completed, so nothing samples these anymore
+		auto& retired = retiredSlots[frameInfo.frameIndex];
+		for (uint32_t textureIndex : retired) {
+			bindless.releaseTexture(textureIndex);
+		}
+		retired.clear();
+
+		computeWantedLevels(frameInfo, objects, viewportHeight);
+		evict(frameInfo);
+		stream(frameInfo);
+	}
+
+	// An object's texture is assumed to cover its bounding sphere once, so the finest useful level is
+	// the coarsest one that still has at least a texel per pixel across the sphere's projected height,
+	// measured at its nearest point like LOD selection.
+	void TextureStreamer::computeWantedLevels(FrameInfo& frameInfo, std::vector<Object>& objects, float viewportHeight) {
+		for (auto& entry : entries) {
+			entry.wantedLevel = entry.tailLevel;
+		}
+
+		for (auto& object : objects) {
+			if (object.model == nullptr) {
+				continue;
+			}
+
+			glm::mat4 modelMatrix = object.transform.mat4();
+			float scale = glm::max(
+				glm::length(glm::vec3{ modelMatrix[0] }),
+				glm::max(glm::length(glm::vec3{ modelMatrix[1] }), glm::length(glm::vec3{ modelMatrix[2] })));
+			float radius = object.model->getBoundingRadius() * scale;
+
+			glm::vec3 center = glm::vec3{ modelMatrix * glm::vec4{ object.model->getBoundingCenter(), 1.0f } };
+			float     depth = frameInfo.camera.getViewDepth(center);
+			if (depth + radius <= 0.0f) {
+				continue;  // behind the camera
+			}
+
+			float pixels = frameInfo.camera.getProjectedHeight(2.0f * radius, depth - radius) * viewportHeight;
+
+			for (uint32_t submesh = 0; submesh < object.model->getSubmeshCount(); submesh++) {
+				uint32_t material = object.model->getSubmesh(submesh).material;
+				if (material >= materialEntries.size() || materialEntries[material] == NO_ENTRY) {
+					continue;
+				}
+
+				Entry& entry = entries[materialEntries[material]];
+				entry.lastUsedFrame = frameCount;
+
+				uint32_t level = entry.finestLevel;
+				while (level < entry.wantedLevel &&
+					static_cast<float>(std::max(entry.source.getLevelWidth(level + 1), entry.source.getLevelHeight(level + 1))) >= pixels) {
+					level++;
+				}
+				entry.wantedLevel = level;
+			}
+		}
+	}
+
+	// Least recently used textures give up levels first, largest images first among equally old
+	// ones. Unused textures drop straight to their tail, visible ones a level at a time. Evictions
+	// don't wait for upload budget: the smaller chain is a fraction of what it replaces.
+	//
+	// A budget callback lowers the limit enough to give back what it asked for and holds it there;
+	// without one the limit grows back by an upload budget per frame, so streaming resumes slowly
+	// instead of running straight back into the pressure.
+	void TextureStreamer::evict(FrameInfo& frameInfo) {
+		if (evictionRequest > 0) {
+			residentLimit = std::min(residentLimit, residentMemory > evictionRequest ? residentMemory - evictionRequest : 0);
+			evictionRequest = 0;
+		} else {
+			residentLimit = std::min(residentLimit + settings.uploadBudget, settings.memoryBudget);
+		}
+
+		if (residentMemory <= residentLimit) {
+			return;
+		}
+
+		std::vector<uint32_t> candidates{};
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			if (entries[i].residentLevel < entries[i].tailLevel) {
+				candidates.push_back(i);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+			if (entries[a].lastUsedFrame != entries[b].lastUsedFrame) {
+				return entries[a].lastUsedFrame < entries[b].lastUsedFrame;
+			}
+			return entries[a].residentLevel < entries[b].residentLevel;
+		});
+
+		for (uint32_t candidate : candidates) {
+			if (residentMemory <= residentLimit) {
+				break;
+			}
+
+			Entry& entry = entries[candidate];
+			makeResident(entry, std::min(std::max(entry.residentLevel + 1, entry.wantedLevel), entry.tailLevel), frameInfo);
+		}
+	}
+
+	// Textures furthest from their wanted level go first, one level per frame each, for as long as
+	// the frame's upload budget and the memory budget allow. The first upload of a frame always goes
+	// through so a level larger than the budget still streams in. A texture whose file can't be
+	// reloaded stays at the levels it has.
+	void TextureStreamer::stream(FrameInfo& frameInfo) {
+		std::vector<uint32_t> candidates{};
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			if (entries[i].wantedLevel < entries[i].residentLevel) {
+				candidates.push_back(i);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+			uint32_t gapA = entries[a].residentLevel - entries[a].wantedLevel;
+			uint32_t gapB = entries[b].residentLevel - entries[b].wantedLevel;
+			if (gapA != gapB) {
+				return gapA > gapB;
+			}
+			return entries[a].residentLevel > entries[b].residentLevel;
+		});
+
+		for (uint32_t candidate : candidates) {
+			Entry&   entry = entries[candidate];
+			uint32_t level = entry.residentLevel - 1;
+
+			VkDeviceSize uploadSize = entry.source.levels[level].size;
+			if (frameUploadBytes > 0 && frameUploadBytes + uploadSize > settings.uploadBudget) {
+				continue;
+			}
+
+			// Scale the stored size by the current image's padding to estimate the new allocation
+			VkDeviceSize currentSize = entry.texture->getMemorySize();
+			VkDeviceSize estimatedSize = entry.source.getStoredSize(level) * currentSize / std::max(entry.source.getStoredSize(entry.residentLevel), VkDeviceSize{ 1 });
+			if (residentMemory - currentSize + estimatedSize > residentLimit) {
+				continue;
+			}
+
+			try {
+				makeResident(entry, level, frameInfo);
+			}
+			catch (const std::runtime_error& error) {
+				std::cerr << "Stopping texture streaming: " << error.what() << std::endl;
+				entry.finestLevel = entry.residentLevel;
+			}
+		}
+	}
+
+	// Staging comes first so a level that can't be reloaded leaves the entry as it was
+	void TextureStreamer::makeResident(Entry& entry, uint32_t level, FrameInfo& frameInfo) {
+		std::vector<std::unique_ptr<Buffer>> overflow{};
+		std::vector<Texture::StagedLevel>    stagedLevels{};
+		for (uint32_t staged = level; staged < entry.residentLevel; staged++) {
+			stagedLevels.push_back(stageLevel(entry, staged, overflow));
+		}
+
+		auto texture = std::make_unique<Texture>(liveDevice, entry.source, level, *entry.texture, entry.residentLevel, stagedLevels, frameInfo.commandBuffer);
+
+		// Frames in flight may still sample the current slot, so the new image gets a slot of its own
+		uint32_t textureIndex = bindless.registerTexture(texture->getDescriptorImageInfo());
+		residentMemory -= entry.texture->getMemorySize();
+		retiredSlots[frameInfo.frameIndex].push_back(entry.textureIndex);
+
+		// The uploaded levels' CPU copies are no longer needed
+		for (uint32_t staged = level; staged < entry.residentLevel; staged++) {
+			VkDeviceSize uploadSize = entry.levelData[staged].size();
+			frameUploadBytes += uploadSize;
+			uploadedBytes += uploadSize;
+			entry.levelData[staged] = {};
+		}
+		residentMemory += texture->getMemorySize();
+
+		// The old image's destructor defers its release past the frames still using it
+		entry.texture = std::move(texture);
+		entry.textureIndex = textureIndex;
+		entry.residentLevel = level;
+		for (uint32_t material : entry.materials) {
+			materialLibrary.setTextureIndex(material, textureIndex);
+		}
+	}
+
+	Texture::StagedLevel TextureStreamer::stageLevel(Entry& entry, uint32_t level, std::vector<std::unique_ptr<Buffer>>& overflow) {
+		if (entry.levelData[level].empty()) {
+			reloadLevels(entry);
+		}
+		std::vector<uint8_t>& data = entry.levelData[level];
+
+		VkDeviceSize offset = (stagingOffset + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+		if (offset + data.size() <= stagingCapacity) {
+			staging->writeToBuffer(data.data(), data.size(), stagingBase + offset);
+			stagingOffset = offset + data.size();
+			return { staging->getBuffer(), stagingBase + offset };
+		}
+
+		// Its destructor defers the release past this frame's submission, like Texture::upload's
+		auto buffer = std::make_unique<Buffer>(
+			liveDevice,
+			data.size(),
+			1,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		buffer->map();
+		buffer->writeToBuffer(data.data());
+		overflow.push_back(std::move(buffer));
+		return { overflow.back()->getBuffer(), 0 };
+	}
+
+	// Decodes the whole file again, which only happens for levels that were evicted, so it is the
+	// price of not holding every level on the CPU
+	void TextureStreamer::reloadLevels(Entry& entry) {
+		Texture::Builder builder{};
+		builder.loadFile(entry.filepath, entry.srgb);
+		builder.generateLevels();
+		if (builder.format != entry.source.format || builder.width != entry.source.width ||
+			builder.height != entry.source.height || builder.levels.size() != entry.source.levels.size()) {
+			throw std::runtime_error(entry.filepath + ": file changed since it was loaded");
+		}
+
+		for (uint32_t level = 0; level < entry.residentLevel; level++) {
+			if (entry.levelData[level].empty()) {
+				const Texture::Level& stored = builder.levels[level];
+				entry.levelData[level].assign(builder.data.begin() + stored.offset, builder.data.begin() + stored.offset + stored.size);
+			}
+		}
+	}
+}
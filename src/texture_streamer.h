@@ -0,0 +1,122 @@
+#pragma once
+
+#include "bindless_descriptors.h"
+#include "buffer.h"
+#include "engine_device.h"
+#include "engine_swap_chain.h"
+#include "frame_info.h"
+#include "material_library.h"
+#include "object.h"
+#include "sampler_cache.h"
+#include "texture.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace live {
+	// Keeps material textures partially resident under a memory budget.
+	//
+	// Every texture starts with only its small tail mips on the GPU. Each frame the streamer works out
+	// the finest level any object using the texture can show (its screen-space size from the camera)
+	// and moves textures one level at a time towards it, most undersampled first. The uploads are
+	// recorded into the frame's command buffer and capped per frame so streaming never stalls
+	// rendering. When the resident set goes over budget, the least recently used textures give up
+	// their finest levels first. The device's budget callback lowers that budget while a device-local
+	// heap is under pressure, and it recovers gradually once the pressure is gone.
+	//
+	// Changing residency builds a new image at the new size and swaps the material's bindless slot to
+	// it; the old image and slot are released once the frames sampling them have completed. The levels
+	// both images hold are copied on the GPU, so a step uploads at most the one new level, staged
+	// through a persistent ring with a region per frame in flight. The CPU only keeps the levels that
+	// aren't on the GPU; levels that are evicted again are reloaded from the file when wanted.
+	class TextureStreamer {
+	public:
+		struct Settings {
+			VkDeviceSize memoryBudget = 256 * 1024 * 1024;
+			VkDeviceSize uploadBudget = 4 * 1024 * 1024;  // staged bytes per frame
+			uint32_t     residentSize = 128;              // largest dimension of the tail, which is always resident
+		};
+
+		TextureStreamer(
+			LiveDevice& device,
+			SamplerCache& samplerCache,
+			BindlessDescriptors& bindlessDescriptors,
+			MaterialLibrary& materialLibrary,
+			const Settings& settings);
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// Loads the diffuse texture of every material in the library that doesn't have one yet and
+		// uploads its resident tail. Materials sharing a file share the texture; one that fails to
+		// load leaves its materials untextured.
+		void loadMaterialTextures(bool srgb = true);
+
+		// Call between beginFrame and the render pass: records this frame's uploads into
+		// frameInfo.commandBuffer and updates the material texture slots the frame will read.
+		void update(FrameInfo& frameInfo, std::vector<Object>& objects, float viewportHeight);
+
+		VkDeviceSize getResidentMemory() const { return residentMemory; }
+		// Settings::memoryBudget, or less while the device is short of memory
+		VkDeviceSize getResidentLimit() const { return residentLimit; }
+		VkDeviceSize getUploadedBytes() const { return uploadedBytes; }
+
+	private:
+		static constexpr uint32_t NO_ENTRY = ~0u;
+
+		struct Entry {
+			std::string              filepath;
+			bool                     srgb = true;
+			Texture::Builder         source;  // format and level sizes; its data is released after loading
+			std::vector<std::vector<uint8_t>> levelData{};  // CPU copies, empty for levels on the GPU
+			std::unique_ptr<Texture> texture{};
+			uint32_t                 textureIndex = BindlessDescriptors::INVALID_INDEX;
+			uint32_t                 residentLevel = 0;  // finest level on the GPU
+			uint32_t                 tailLevel = 0;      // coarsest level residentLevel ever drops to
+			uint32_t                 finestLevel = 0;    // raised when the file can no longer be reloaded
+			uint32_t                 wantedLevel = 0;    // finest level visible this frame
+			uint64_t                 lastUsedFrame = 0;
+			std::vector<uint32_t>    materials{};
+		};
+
+		void onMemoryPressure(const MemoryHeapUsage& heap, VkDeviceSize excess);
+		void computeWantedLevels(FrameInfo& frameInfo, std::vector<Object>& objects, float viewportHeight);
+		void evict(FrameInfo& frameInfo);
+		void stream(FrameInfo& frameInfo);
+		// Rebuilds the entry's image starting at level from the current one
+		void makeResident(Entry& entry, uint32_t level, FrameInfo& frameInfo);
+		// Copies a level into this frame's staging region, or a buffer of its own if it doesn't fit
+		Texture::StagedLevel stageLevel(Entry& entry, uint32_t level, std::vector<std::unique_ptr<Buffer>>& overflow);
+		void reloadLevels(Entry& entry);
+
+		LiveDevice&          liveDevice;
+		SamplerCache&        samplerCache;
+		BindlessDescriptors& bindless;
+		MaterialLibrary&     materialLibrary;
+		Settings             settings;
+
+		std::vector<Entry>    entries{};
+		std::vector<uint32_t> materialEntries{};  // entry of each material id, NO_ENTRY without a texture
+
+		// Bindless slots replaced during each frame slot, released when that slot comes around again
+		std::array<std::vector<uint32_t>, LiveSwapChain::MAX_FRAMES_IN_FLIGHT> retiredSlots{};
+
+		// Upload budget sized region per frame in flight, recycled like the FrameAllocator's
+		std::unique_ptr<Buffer> staging{};
+		VkDeviceSize          stagingCapacity = 0;  // per frame
+		VkDeviceSize          stagingBase = 0;
+		VkDeviceSize          stagingOffset = 0;
+
+		uint32_t              budgetCallback;
+		VkDeviceSize          residentLimit;
+		VkDeviceSize          evictionRequest = 0;  // bytes asked back by the last budget callback
+		VkDeviceSize          residentMemory = 0;
+		VkDeviceSize          frameUploadBytes = 0;
+		VkDeviceSize          uploadedBytes = 0;
+		uint64_t              frameCount = 0;
+	};
+}